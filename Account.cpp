@@ -1,31 +1,76 @@
 #include "Account.h"
+#include "NamePool.h"
 
-Account::Account(int new_id, double new_balance, std::string new_name) {
+Account::Account(int new_id, Money new_balance, std::string_view new_name) {
     id = new_id;
-    balance = new_balance;
-    name = new_name;
+    balance.store(new_balance.minorUnits(), std::memory_order_relaxed);
+    name = NamePool::instance().intern(new_name);
+}
+
+Account::Account() : id(0), balance(0) {}
+
+Account::Account(const Account &other)
+    : id(other.id), balance(other.balance.load(std::memory_order_relaxed)), name(other.name) {}
+
+Account& Account::operator=(const Account &other) {
+    id = other.id;
+    balance.store(other.balance.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    name = other.name;
+    return *this;
 }
 
 int Account::getId() const {
     return id;
 }
 
-std::string Account::getName() const {
+std::string_view Account::getName() const {
     return name;
 }
 
-double Account::getBalance() const {
-    return balance;
+Money Account::getBalance() const {
+    return Money::fromMinorUnits(balance.load(std::memory_order_relaxed));
 }
 
-void Account::deposit(double amount) {
-    balance += amount;
+bool Account::deposit(Money amount) {
+    if (amount < Money()) {
+        return false;  // Negative deposits would bypass the withdrawal checks
+    }
+    Money updated;
+    if (!getBalance().checkedAdd(amount, updated)) return false;  // Fails on overflow, leaving balance unchanged
+    balance.store(updated.minorUnits(), std::memory_order_relaxed);
+    return true;
 }
 
-bool Account::withdraw(double amount) {
-    if (amount > balance) {
+bool Account::withdraw(Money amount) {
+    Money current = getBalance();
+    if (amount < Money() || amount > current) {
         return false;  // Withdrawal amount exceeds balance
     }
-    balance -= amount;  // Withdrawal successful
+    balance.store(current.minorUnits() - amount.minorUnits(), std::memory_order_relaxed);
+    return true;  // Cannot overflow: 0 <= amount <= current
+}
+
+bool Account::depositAtomic(Money amount) {
+    if (amount < Money()) {
+        return false;
+    }
+    // A plain fetch_add could not refuse an overflowing deposit, so retry until no
+    // other update lands between reading the balance and swapping in the new one.
+    std::int64_t current = balance.load(std::memory_order_relaxed);
+    std::int64_t updated;
+    do {
+        if (__builtin_add_overflow(current, amount.minorUnits(), &updated)) return false;
+    } while (!balance.compare_exchange_weak(current, updated, std::memory_order_relaxed));
+    return true;
+}
+
+bool Account::withdrawAtomic(Money amount) {
+    if (amount < Money()) {
+        return false;
+    }
+    std::int64_t current = balance.load(std::memory_order_relaxed);
+    do {
+        if (amount.minorUnits() > current) return false;  // Insufficient funds as of the latest balance
+    } while (!balance.compare_exchange_weak(current, current - amount.minorUnits(), std::memory_order_relaxed));
     return true;
 }
@@ -1,18 +1,33 @@
 #ifndef ACCOUNT_H
 #define ACCOUNT_H
 
-#include <string>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include "Money.h"
 
 // The Account class represents a bank account with basic functionalities.
+//
+// The balance is held as an atomic count of minor units. deposit() and withdraw()
+// expect the caller to serialize updates to the account, and cost the same as plain
+// loads and stores; depositAtomic() and withdrawAtomic() may race with each other
+// and with getBalance() on any number of threads without a lock.
 class Account {
 public:
     /**
      * Constructor to create a new Account object
      * @param new_id An integer representing the unique ID of the account.
-     * @param new_balance A double representing the initial balance of the account.
-     * @param new_name A string representing the name of the account holder
+     * @param new_balance A Money amount representing the initial balance of the account.
+     * @param new_name A string representing the name of the account holder, interned in the NamePool
     */
-    Account(int new_id, double new_balance, std::string new_name);
+    Account(int new_id, Money new_balance, std::string_view new_name);
+
+    // Creates a placeholder account with id 0, no balance and no name, for storage to be assigned later.
+    Account();
+
+    // Copies an account. The source must not be updated during the copy.
+    Account(const Account &other);
+    Account& operator=(const Account &other);
 
     /**
      * Retrieves the account's ID.
@@ -22,34 +37,51 @@ public:
 
     /**
      * Retrieves the name of the account holder
-     * @return A string representing the name of the account holder
+     * @return A view of the interned name of the account holder, valid for the whole process
     */
-    std::string getName() const;
+    std::string_view getName() const;
 
     /**
      * Retrieves the current balance of the account
-     * @return A douuble representing the current balance of the current account
+     * @return A Money amount representing the current balance of the current account
     */
-    double getBalance() const;
+    Money getBalance() const;
 
     /**
      * Deposits the specified amount into the account
-     * @param A double representing the amouunt to be deposited
+     * @param A Money amount representing the amouunt to be deposited
+     * @return true if the deposit is successful, false if the amount is negative or the balance would overflow.
     */
-    void deposit(double amount);
+    bool deposit(Money amount);
 
     /**
      * Attempts to withdraw the specified amount from the account.
-     * If the amount if greater than the current balance the withdrawal fails.
-     * @param A double representing the amount to be withdrawn.
+     * If the amount if negative or greater than the current balance the withdrawal fails.
+     * @param A Money amount representing the amount to be withdrawn.
      * @return true if the withdrawak is successful, false otherwise.
     */
-    bool withdraw(double amount);
+    bool withdraw(Money amount);
+
+    /**
+     * Deposits the specified amount with a compare-and-swap loop, safe against
+     * concurrent atomic updates of the same account.
+     * @param A Money amount representing the amount to be deposited
+     * @return true if the deposit is successful, false if the amount is negative or the balance would overflow.
+    */
+    bool depositAtomic(Money amount);
+
+    /**
+     * Withdraws the specified amount with a compare-and-swap loop, safe against
+     * concurrent atomic updates of the same account. The balance never goes negative.
+     * @param A Money amount representing the amount to be withdrawn.
+     * @return true if the withdrawal is successful, false if the amount is negative or exceeds the balance.
+    */
+    bool withdrawAtomic(Money amount);
 
 private:
     int id;               // Unique identifier for the account
-    double balance;       // Current balance of the account
-    std::string name;     // Name of the account holder
+    std::atomic<std::int64_t> balance; // Current balance of the account, in minor units
+    std::string_view name; // Name of the account holder, stored in the NamePool
 };
 
 #endif // ACCOUNT_H
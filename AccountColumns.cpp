@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <atomic>
+#include "AccountColumns.h"
+
+// Balance filters gather matches for this many rows in a stack buffer before
+// appending them, which keeps the comparison loop free of data-dependent branches.
+const std::size_t SCAN_BLOCK = 64;
+
+AccountColumns::AccountColumns() : current(std::make_shared<Version>()) {}
+
+AccountColumns::Chunk& AccountColumns::writableChunk(std::size_t slot) {
+    // A use count above one means a view shares it, and views must never change.
+    if (current.use_count() > 1) current = std::make_shared<Version>(*current);
+    std::shared_ptr<Chunk> &chunk = current->chunks[slot / CHUNK_ROWS];
+    if (chunk.use_count() > 1) chunk = std::make_shared<Chunk>(*chunk);
+    // use_count() is a relaxed load: order the write after the last view's reads,
+    // which the view released when it dropped its reference on another thread.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *chunk;
+}
+
+void AccountColumns::assign(std::size_t slot, const Account &account) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= current->rows) {
+        if (current.use_count() > 1) current = std::make_shared<Version>(*current);
+        while (current->chunks.size() * CHUNK_ROWS <= slot) {
+            current->chunks.push_back(std::make_shared<Chunk>()); // Zeroed: every row free
+        }
+        current->rows = slot + 1;
+    }
+    Chunk &chunk = writableChunk(slot);
+    std::size_t row = slot % CHUNK_ROWS;
+    chunk.ids[row] = account.getId();
+    chunk.balances[row] = account.getBalance().minorUnits();
+    chunk.names[row] = account.getName();
+    chunk.live[row] = 1;
+}
+
+void AccountColumns::erase(std::size_t slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Chunk &chunk = writableChunk(slot);
+    std::size_t row = slot % CHUNK_ROWS;
+    chunk.ids[row] = 0;
+    chunk.balances[row] = 0; // Lets totalBalance() sum the whole column without a mask.
+    chunk.names[row] = std::string_view();
+    chunk.live[row] = 0;
+}
+
+void AccountColumns::setBalance(std::size_t slot, Money balance) {
+    std::lock_guard<std::mutex> lock(mutex);
+    writableChunk(slot).balances[slot % CHUNK_ROWS] = balance.minorUnits();
+}
+
+void AccountColumns::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = std::make_shared<Version>();
+}
+
+void AccountColumns::reserve(std::size_t rows) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.use_count() > 1) current = std::make_shared<Version>(*current);
+    current->chunks.reserve((rows + CHUNK_ROWS - 1) / CHUNK_ROWS);
+}
+
+std::size_t AccountColumns::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current->rows;
+}
+
+AccountColumns::View AccountColumns::view() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return View(current);
+}
+
+std::vector<std::uint32_t> AccountColumns::slotsWithBalanceAbove(Money minBalance) const {
+    return view().slotsWithBalanceAbove(minBalance);
+}
+
+std::size_t AccountColumns::countBalanceAbove(Money minBalance) const {
+    return view().countBalanceAbove(minBalance);
+}
+
+bool AccountColumns::totalBalance(Money &total) const {
+    return view().totalBalance(total);
+}
+
+std::vector<std::uint32_t> AccountColumns::slotsWithNameContaining(std::string_view text) const {
+    return view().slotsWithNameContaining(text);
+}
+
+AccountColumns::View::View(std::shared_ptr<const Version> version) : version(std::move(version)) {}
+
+std::size_t AccountColumns::View::size() const {
+    return version ? version->rows : 0;
+}
+
+bool AccountColumns::View::isLive(std::size_t slot) const {
+    return version->chunks[slot / CHUNK_ROWS]->live[slot % CHUNK_ROWS];
+}
+
+int AccountColumns::View::id(std::size_t slot) const {
+    return version->chunks[slot / CHUNK_ROWS]->ids[slot % CHUNK_ROWS];
+}
+
+Money AccountColumns::View::balance(std::size_t slot) const {
+    return Money::fromMinorUnits(version->chunks[slot / CHUNK_ROWS]->balances[slot % CHUNK_ROWS]);
+}
+
+std::string_view AccountColumns::View::name(std::size_t slot) const {
+    return version->chunks[slot / CHUNK_ROWS]->names[slot % CHUNK_ROWS];
+}
+
+std::vector<std::uint32_t> AccountColumns::View::slotsWithBalanceAbove(Money minBalance) const {
+    std::vector<std::uint32_t> slots;
+    const std::int64_t threshold = minBalance.minorUnits();
+    std::uint32_t block[SCAN_BLOCK];
+    for (std::size_t first = 0; first < size(); first += CHUNK_ROWS) {
+        const Chunk &chunk = *version->chunks[first / CHUNK_ROWS];
+        std::size_t rows = std::min(size() - first, CHUNK_ROWS);
+        for (std::size_t base = 0; base < rows; base += SCAN_BLOCK) {
+            std::size_t end = std::min(rows - base, SCAN_BLOCK);
+            // Branch-free pass: every slot is written, but the cursor only advances on a match.
+            std::size_t found = 0;
+            for (std::size_t i = 0; i < end; ++i) {
+                block[found] = static_cast<std::uint32_t>(first + base + i);
+                found += chunk.live[base + i] & (chunk.balances[base + i] > threshold);
+            }
+            slots.insert(slots.end(), block, block + found);
+        }
+    }
+    return slots;
+}
+
+std::size_t AccountColumns::View::countBalanceAbove(Money minBalance) const {
+    std::size_t count = 0;
+    const std::int64_t threshold = minBalance.minorUnits();
+    for (std::size_t first = 0; first < size(); first += CHUNK_ROWS) {
+        const Chunk &chunk = *version->chunks[first / CHUNK_ROWS];
+        std::size_t rows = std::min(size() - first, CHUNK_ROWS);
+        for (std::size_t i = 0; i < rows; ++i) {
+            count += chunk.live[i] & (chunk.balances[i] > threshold);
+        }
+    }
+    return count;
+}
+
+bool AccountColumns::View::totalBalance(Money &total) const {
+    // Integer addition is associative, so the compiler is free to vectorize this loop
+    // with several accumulators; a double sum has to run one add after another. Each
+    // balance is summed as its low and high 32 bits, which cannot overflow for fewer
+    // than 2^32 slots, so the exact total is put together once at the end.
+    std::uint64_t low = 0;
+    std::int64_t high = 0;
+    for (std::size_t first = 0; first < size(); first += CHUNK_ROWS) {
+        const std::int64_t *column = version->chunks[first / CHUNK_ROWS]->balances;
+        std::size_t rows = std::min(size() - first, CHUNK_ROWS);
+        for (std::size_t i = 0; i < rows; ++i) {
+            low += static_cast<std::uint32_t>(column[i]);
+            high += column[i] >> 32;
+        }
+    }
+    __int128 sum = (static_cast<__int128>(high) << 32) + low;
+    if (sum < INT64_MIN || sum > INT64_MAX) return false;
+    total = Money::fromMinorUnits(static_cast<std::int64_t>(sum));
+    return true;
+}
+
+std::vector<std::uint32_t> AccountColumns::View::slotsWithNameContaining(std::string_view text) const {
+    std::vector<std::uint32_t> slots;
+    for (std::uint32_t slot = 0; slot < size(); ++slot) {
+        if (isLive(slot) && name(slot).find(text) != std::string_view::npos) slots.push_back(slot);
+    }
+    return slots;
+}
@@ -0,0 +1,167 @@
+#ifndef ACCOUNT_COLUMNS_H
+#define ACCOUNT_COLUMNS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "Account.h"
+
+// The AccountColumns class stores accounts as a structure of arrays: one contiguous
+// column per field, all indexed by the same slot. Scans that only need one field
+// (such as balance filters and totals) then stream through a single dense array.
+// Slots match the AccountStore, so a freed slot leaves a hole until it is reused.
+//
+// The columns are split into fixed-size chunks shared through reference counts, so
+// view() can hand out a frozen point-in-time copy in O(1). A write to a chunk that
+// a view still shares copies that chunk first; views never see later writes, and a
+// chunk is freed as soon as neither the columns nor any view refer to it.
+class AccountColumns {
+public:
+    static constexpr std::size_t CHUNK_ROWS = 1024;  // Rows per chunk
+
+    // One chunk of rows, one array per column.
+    struct Chunk {
+        int ids[CHUNK_ROWS];                  // Account ids
+        std::int64_t balances[CHUNK_ROWS];    // Account balances in minor units
+        std::string_view names[CHUNK_ROWS];   // Account holder names, pointing into the NamePool
+        std::uint8_t live[CHUNK_ROWS];        // 1 for slots holding an account, 0 for free slots
+    };
+
+    // One version of the columns: its chunks in slot order and its number of rows.
+    struct Version {
+        std::vector<std::shared_ptr<Chunk>> chunks;
+        std::size_t rows = 0;
+    };
+
+    // A consistent, read-only view of the columns as they were when it was taken.
+    // A view can be read on any thread while the columns keep changing.
+    class View {
+    public:
+        View() = default;
+
+        // Returns the number of rows, live or free.
+        std::size_t size() const;
+
+        // Tells whether a slot below size() held an account.
+        bool isLive(std::size_t slot) const;
+
+        // Returns the id stored for a slot below size().
+        int id(std::size_t slot) const;
+
+        // Returns the balance stored for a slot below size().
+        Money balance(std::size_t slot) const;
+
+        // Returns the holder name stored for a slot below size().
+        std::string_view name(std::size_t slot) const;
+
+        /**
+         * Collects the slots whose balance is strictly greater than a minimum.
+         * @param minBalance The exclusive lower bound.
+         * @return The matching slots in ascending order.
+        */
+        std::vector<std::uint32_t> slotsWithBalanceAbove(Money minBalance) const;
+
+        /**
+         * Counts the slots whose balance is strictly greater than a minimum.
+         * @param minBalance The exclusive lower bound.
+        */
+        std::size_t countBalanceAbove(Money minBalance) const;
+
+        /**
+         * Sums every balance in the view exactly.
+         * @param total Receives the sum.
+         * @return false if the sum does not fit in a Money, true otherwise.
+        */
+        bool totalBalance(Money &total) const;
+
+        /**
+         * Collects the slots whose holder name contains the given text.
+         * @param text The substring to look for.
+         * @return The matching slots in ascending order.
+        */
+        std::vector<std::uint32_t> slotsWithNameContaining(std::string_view text) const;
+
+    private:
+        friend class AccountColumns;
+        explicit View(std::shared_ptr<const Version> version);
+
+        std::shared_ptr<const Version> version;  // The frozen version; null for an empty view
+    };
+
+    AccountColumns();
+
+    /**
+     * Stores an account's fields at a slot, growing the columns if needed.
+     * @param slot The slot the account occupies in the AccountStore.
+     * @param account The account whose fields are copied into the columns.
+    */
+    void assign(std::size_t slot, const Account &account);
+
+    /**
+     * Marks a slot as free. Free slots hold a zero balance and are skipped by every scan.
+     * @param slot The slot to free. Must be less than size().
+    */
+    void erase(std::size_t slot);
+
+    /**
+     * Updates the balance stored for a slot.
+     * @param slot The slot to update.
+     * @param balance The new balance.
+    */
+    void setBalance(std::size_t slot, Money balance);
+
+    // Removes every row.
+    void clear();
+
+    // Reserves room for the given number of rows in every column.
+    void reserve(std::size_t rows);
+
+    // Returns the number of rows, live or free.
+    std::size_t size() const;
+
+    // Takes a point-in-time view of the columns in O(1). Safe to call from any thread.
+    View view() const;
+
+    /**
+     * Collects the slots whose balance is strictly greater than a minimum.
+     * @param minBalance The exclusive lower bound.
+     * @return The matching slots in ascending order.
+    */
+    std::vector<std::uint32_t> slotsWithBalanceAbove(Money minBalance) const;
+
+    /**
+     * Counts the slots whose balance is strictly greater than a minimum.
+     * @param minBalance The exclusive lower bound.
+    */
+    std::size_t countBalanceAbove(Money minBalance) const;
+
+    /**
+     * Sums every balance in the column exactly.
+     * @param total Receives the sum.
+     * @return false if the sum does not fit in a Money, true otherwise.
+    */
+    bool totalBalance(Money &total) const;
+
+    /**
+     * Collects the slots whose holder name contains the given text.
+     * @param text The substring to look for.
+     * @return The matching slots in ascending order.
+    */
+    std::vector<std::uint32_t> slotsWithNameContaining(std::string_view text) const;
+
+private:
+    /**
+     * Returns the chunk holding a slot, ready to be written: the version and the
+     * chunk are copied first if a view shares them. The caller holds the mutex.
+     * @param slot A slot below size().
+    */
+    Chunk& writableChunk(std::size_t slot);
+
+    mutable std::mutex mutex;                 // Orders writes against view()
+    std::shared_ptr<Version> current;         // The version writes go to
+};
+
+#endif // ACCOUNT_COLUMNS_H
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <thread>
+#include "AccountCsv.h"
+
+// Files smaller than this are parsed on the calling thread only.
+const std::size_t MIN_BYTES_PER_THREAD = 1 << 20;
+
+bool AccountCsv::parseLine(std::string_view line, AccountRow &row) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1); // Windows line endings
+    std::size_t firstComma = line.find(',');
+    std::size_t lastComma = line.rfind(',');
+    if (firstComma == std::string_view::npos || firstComma == lastComma) return false;
+
+    // from_chars alone would also take a sign and any number of digits.
+    std::string_view id = line.substr(0, firstComma);
+    if (id.size() != ID_DIGITS || !std::all_of(id.begin(), id.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    std::from_chars(id.data(), id.data() + id.size(), row.id);
+
+    row.name = line.substr(firstComma + 1, lastComma - firstComma - 1);
+    return Money::parse(line.substr(lastComma + 1), row.balance) && row.balance >= Money();
+}
+
+/**
+ * Parses every line of a chunk that starts at a line boundary.
+ * @param chunk The text to parse.
+ * @param rows Receives the valid rows.
+ * @param rejected Receives the number of non-empty lines that did not parse.
+ */
+static void parseChunk(std::string_view chunk, std::vector<AccountRow> &rows, std::size_t &rejected) {
+    rejected = 0;
+    while (!chunk.empty()) {
+        std::size_t end = chunk.find('\n');
+        std::string_view line = chunk.substr(0, end);
+        chunk.remove_prefix(end == std::string_view::npos ? chunk.size() : end + 1);
+        if (line.empty() || line == "\r") continue;
+        AccountRow row;
+        if (AccountCsv::parseLine(line, row)) rows.push_back(row);
+        else ++rejected;
+    }
+}
+
+std::vector<AccountRow> AccountCsv::parse(std::string_view text, unsigned threads, std::size_t &rejected) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, text.size() / MIN_BYTES_PER_THREAD + 1));
+
+    // Cut the text into roughly equal chunks, moving each cut forward to a newline.
+    std::vector<std::string_view> chunks;
+    std::size_t begin = 0;
+    for (unsigned i = 1; i <= threads && begin < text.size(); ++i) {
+        std::size_t end = i == threads ? text.size() : text.size() / threads * i;
+        if (end < begin) end = begin;
+        end = text.find('\n', end);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    std::vector<std::vector<AccountRow>> parts(chunks.size());
+    std::vector<std::size_t> partRejected(chunks.size());
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < chunks.size(); ++i) {
+        workers.emplace_back(parseChunk, chunks[i], std::ref(parts[i]), std::ref(partRejected[i]));
+    }
+    if (!chunks.empty()) parseChunk(chunks[0], parts[0], partRejected[0]);
+    for (auto &worker : workers) worker.join();
+
+    // Concatenate in chunk order so the rows keep their file order.
+    std::size_t total = 0;
+    for (const auto &part : parts) total += part.size();
+    std::vector<AccountRow> rows;
+    rows.reserve(total);
+    rejected = 0;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        rows.insert(rows.end(), parts[i].begin(), parts[i].end());
+        rejected += partRejected[i];
+    }
+    return rows;
+}
@@ -0,0 +1,44 @@
+#ifndef ACCOUNT_CSV_H
+#define ACCOUNT_CSV_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "Money.h"
+
+// One parsed line of an account CSV file. The name points into the parsed text.
+struct AccountRow {
+    int id;
+    std::string_view name;
+    Money balance;
+};
+
+// The AccountCsv class parses account files with one "id,name,balance" line per
+// account, e.g. "1111111,Alex Johnson,1040.45". Ids have exactly seven digits, as
+// the menus require, balances may not be negative, and names may not contain commas.
+// Lines that do not parse, such as a header line, are skipped and counted.
+class AccountCsv {
+public:
+    /**
+     * Parses a single line.
+     * @param line The line without its terminating newline.
+     * @param row Receives the parsed fields on success.
+     * @return true if the line is a valid account row, false otherwise.
+    */
+    static bool parseLine(std::string_view line, AccountRow &row);
+
+    /**
+     * Parses a whole file's contents, splitting the work into newline-aligned
+     * chunks that are parsed on separate threads.
+     * @param text The file contents. The returned rows point into it.
+     * @param threads The number of threads to use; 0 picks one per hardware thread.
+     * @param rejected Receives the number of non-empty lines that did not parse.
+     * @return The valid rows in file order.
+    */
+    static std::vector<AccountRow> parse(std::string_view text, unsigned threads, std::size_t &rejected);
+
+private:
+    static const std::size_t ID_DIGITS = 7;     // Digits in an account id
+};
+
+#endif // ACCOUNT_CSV_H
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include "AccountStore.h"
+
+AccountStore::Slot& AccountStore::entry(std::uint32_t slot) const {
+    return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE];
+}
+
+AccountHandle AccountStore::create(const Account &account) {
+    std::uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if (usedSlots == chunks.size() * CHUNK_SIZE) addChunk();
+        slot = usedSlots++;
+    }
+    Slot &target = entry(slot);
+    target.account = account;
+    target.occupied = true;
+    ++liveAccounts;
+    return AccountHandle{slot, target.generation.load(std::memory_order_relaxed)};
+}
+
+bool AccountStore::destroy(AccountHandle handle) {
+    if (!retire(handle)) return false;
+    release(handle.slot);
+    return true;
+}
+
+bool AccountStore::retire(AccountHandle handle) {
+    if (get(handle) == nullptr) return false;
+    Slot &target = entry(handle.slot);
+    target.retired = true;
+    // Every handle issued for the old account is now stale. The fence keeps the slot's
+    // later reuse from becoming visible to readBalance() before the new generation.
+    target.generation.store(handle.generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    --liveAccounts;
+    return true;
+}
+
+void AccountStore::release(std::uint32_t slot) {
+    Slot &target = entry(slot);
+    target.occupied = false;
+    target.retired = false;
+    freeSlots.push_back(slot);
+}
+
+Account* AccountStore::get(AccountHandle handle) const {
+    if (handle.slot >= usedSlots) return nullptr;
+    Slot &target = entry(handle.slot);
+    if (target.generation.load(std::memory_order_relaxed) != handle.generation || !target.occupied || target.retired) {
+        return nullptr;
+    }
+    return &target.account;
+}
+
+bool AccountStore::readBalance(AccountHandle handle, Money &balance) const {
+    if (handle.isNull()) return false;
+    // A handle's chunk is in every directory published since the handle was issued.
+    Slot **chunkTable = directory.load(std::memory_order_acquire);
+    const Slot &target = chunkTable[handle.slot / CHUNK_SIZE][handle.slot % CHUNK_SIZE];
+    if (target.generation.load(std::memory_order_acquire) != handle.generation) return false;
+    // The balance is one atomic word, so it cannot be torn by a concurrent update, and
+    // the slot's Account is never destroyed, so the word is always there to read. If
+    // the account was deleted meanwhile, the value may come from whatever reused the
+    // slot; the generation, read again, then tells to throw it away.
+    Money read = target.account.getBalance();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (target.generation.load(std::memory_order_relaxed) != handle.generation) return false;
+    balance = read;
+    return true;
+}
+
+AccountHandle AccountStore::handleAt(std::uint32_t slot) const {
+    return AccountHandle{slot, entry(slot).generation.load(std::memory_order_relaxed)};
+}
+
+Account& AccountStore::at(std::uint32_t slot) const {
+    return entry(slot).account;
+}
+
+bool AccountStore::isLive(std::uint32_t slot) const {
+    return slot < usedSlots && entry(slot).occupied && !entry(slot).retired;
+}
+
+void AccountStore::prefetch(std::uint32_t slot) const {
+    if (slot < usedSlots) __builtin_prefetch(&entry(slot), 1);
+}
+
+std::uint32_t AccountStore::slotCount() const {
+    return usedSlots;
+}
+
+void AccountStore::reserve(std::size_t accounts) {
+    std::size_t needed = usedSlots + (accounts > freeSlots.size() ? accounts - freeSlots.size() : 0);
+    chunks.reserve((needed + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    while (chunks.size() * CHUNK_SIZE < needed) addChunk();
+}
+
+void AccountStore::addChunk() {
+    chunks.emplace_back(new Slot[CHUNK_SIZE]);
+    if (chunks.size() > directoryCapacity) {
+        // Readers may still be using the current directory, so copy it into a larger one
+        // instead of growing it in place, and keep the old one until the store goes away.
+        std::size_t capacity = std::max<std::size_t>(16, directoryCapacity * 2);
+        std::unique_ptr<Slot*[]> grown(new Slot*[capacity]);
+        for (std::size_t i = 0; i + 1 < chunks.size(); ++i) grown[i] = chunks[i].get();
+        directories.push_back(std::move(grown));
+        directoryCapacity = capacity;
+        directory.store(directories.back().get(), std::memory_order_release);
+    }
+    // Only handles issued after this write point into the new chunk.
+    directories.back()[chunks.size() - 1] = chunks.back().get();
+}
+
+std::size_t AccountStore::size() const {
+    return liveAccounts;
+}
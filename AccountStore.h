@@ -0,0 +1,141 @@
+#ifndef ACCOUNT_STORE_H
+#define ACCOUNT_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Account.h"
+
+// A generation-checked reference to an account in an AccountStore. A handle stays
+// valid across inserts, deletes and reorderings of other accounts, and becomes
+// stale (dereferences to nullptr) once its own account is deleted, even if the
+// slot is later reused.
+struct AccountHandle {
+    std::uint32_t slot = UINT32_MAX;  // Position of the account in the store
+    std::uint32_t generation = 0;     // Generation of the slot when the handle was issued
+
+    // Tells whether the handle was ever issued by a store.
+    bool isNull() const { return slot == UINT32_MAX; }
+};
+
+// The AccountStore class is a slab allocator for accounts. Accounts live in fixed-size
+// chunks that are never reallocated, so an account is copied in once and never moved
+// afterwards. Freed slots are recycled through a free list; the Account in a slot is
+// assigned to, never destroyed, so its balance word outlives every account it held.
+// Deletion can be split in two: retire() invalidates handles in O(1) while keeping
+// the account readable for index cleanup, and release() later frees the slot.
+//
+// The store is not thread-safe, except for readBalance(): a slot's generation only
+// changes when its account is retired, so it doubles as the sequence number of a
+// seqlock, letting readers check a balance they read without a lock against any
+// delete that raced with them.
+class AccountStore {
+public:
+    /**
+     * Copies an account into a free slot.
+     * @param account The account to store.
+     * @return A handle to the stored account.
+    */
+    AccountHandle create(const Account &account);
+
+    /**
+     * Deletes the account a handle refers to and recycles its slot.
+     * @param handle A handle to a live account.
+     * @return true if the handle was live, false if it was stale.
+    */
+    bool destroy(AccountHandle handle);
+
+    /**
+     * Turns a live account into a tombstone. Every handle to it becomes stale and
+     * isLive() reports false, but at() can still read it until release().
+     * @param handle A handle to a live account.
+     * @return true if the handle was live, false if it was stale.
+    */
+    bool retire(AccountHandle handle);
+
+    /**
+     * Frees the slot of a retired account for reuse.
+     * @param slot A slot previously passed to retire().
+    */
+    void release(std::uint32_t slot);
+
+    /**
+     * Dereferences a handle in O(1).
+     * @param handle The handle to dereference.
+     * @return A pointer to the account, or nullptr if the handle is stale.
+    */
+    Account* get(AccountHandle handle) const;
+
+    /**
+     * Reads the balance of the account a handle refers to without any lock, while
+     * another thread may be creating, retiring or releasing accounts or changing
+     * balances. Never blocks and writes no shared memory.
+     * @param handle A handle issued by this store.
+     * @param balance Receives the balance.
+     * @return true if the account was live during the read, false if the handle is stale.
+    */
+    bool readBalance(AccountHandle handle, Money &balance) const;
+
+    /**
+     * Returns the current handle of a live slot.
+     * @param slot A slot below slotCount() for which isLive() is true.
+    */
+    AccountHandle handleAt(std::uint32_t slot) const;
+
+    /**
+     * Returns the account in a live or retired slot.
+     * @param slot A slot below slotCount() that holds a live or retired account.
+    */
+    Account& at(std::uint32_t slot) const;
+
+    // Tells whether a slot currently holds an account.
+    bool isLive(std::uint32_t slot) const;
+
+    /**
+     * Starts loading a slot into the cache for writing, without waiting for it, so a
+     * later get() or at() of the slot finds it there.
+     * @param slot Any slot; slots never handed out are ignored.
+    */
+    void prefetch(std::uint32_t slot) const;
+
+    // Returns the number of slots ever handed out, live or free.
+    std::uint32_t slotCount() const;
+
+    /**
+     * Allocates enough chunks up front for a number of additional accounts.
+     * @param accounts The number of accounts about to be created.
+    */
+    void reserve(std::size_t accounts);
+
+    // Returns the number of live accounts, not counting retired ones.
+    std::size_t size() const;
+
+private:
+    // One slab entry: the account storage and the generation of the slot.
+    struct Slot {
+        Account account;                            // Balance read without a lock by readBalance()
+        std::atomic<std::uint32_t> generation{0};   // Read without a lock by readBalance()
+        bool occupied = false;                      // Holds a live or retired account
+        bool retired = false;
+    };
+
+    // Returns the entry for a slot.
+    Slot& entry(std::uint32_t slot) const;
+
+    // Helper function to allocate one more chunk and publish its address to readers
+    void addChunk();
+
+    static const std::uint32_t CHUNK_SIZE = 4096;    // Slots per chunk
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;      // Chunks in slot order; never moved
+    std::vector<std::unique_ptr<Slot*[]>> directories; // Every chunk directory published; old ones stay readable
+    std::atomic<Slot**> directory{nullptr};           // Chunk addresses by chunk index, for readBalance()
+    std::size_t directoryCapacity = 0;                // Chunks the newest directory can hold
+    std::vector<std::uint32_t> freeSlots;             // Slots ready for reuse
+    std::uint32_t usedSlots = 0;                      // High-water mark of handed-out slots
+    std::size_t liveAccounts = 0;                     // Number of live accounts
+};
+
+#endif // ACCOUNT_STORE_H
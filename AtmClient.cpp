@@ -0,0 +1,172 @@
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Test client for the ATM server started with "BankApp --serve <socket>". Build with
+//   g++ -O2 AtmClient.cpp -o AtmClient
+// Interactive: sends each line typed on stdin and prints the reply.
+//   ./AtmClient /tmp/atm.sock
+// Load test: opens many sessions at once, each logging into an account and then
+// running rounds of deposit, withdraw and balance with one request in flight.
+//   ./AtmClient /tmp/atm.sock --sessions 2000 --rounds 50 --account 1111111
+
+using Clock = std::chrono::steady_clock;
+
+// One load-test session: its socket and its progress through the script.
+struct ClientSession {
+    int fd;
+    int step = 0;           // Requests answered so far
+    std::string input;      // Reply bytes received but not yet complete
+};
+
+/**
+ * Connects a blocking or non-blocking stream socket to a Unix domain socket.
+ * @return The connected socket, or -1 on failure.
+ */
+int connectTo(const std::string &path, bool nonBlocking) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    // Connect while blocking: a Unix socket connect either succeeds or fails at once
+    // unless the backlog is full, and then waiting is what we want.
+    if (nonBlocking) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * Sends a whole buffer on a socket.
+ * @return true if every byte was sent, false otherwise.
+ */
+bool sendAll(int fd, const std::string &data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        sent += written;
+    }
+    return true;
+}
+
+/**
+ * Returns the request a load-test session sends at a step of its script.
+ */
+std::string request(int step, const std::string &account) {
+    if (step == 0) return "LOGIN " + account + "\n";
+    switch ((step - 1) % 3) {
+        case 0: return "DEP 1.00\n";
+        case 1: return "WD 1.00\n";
+        default: return "BAL\n";
+    }
+}
+
+/**
+ * Sends each line of standard input to the server and prints the replies.
+ */
+int interactive(const std::string &path) {
+    int fd = connectTo(path, false);
+    if (fd < 0) {
+        std::cerr << "Could not connect to " << path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::string line, reply;
+    char c;
+    while (std::getline(std::cin, line)) {
+        if (!sendAll(fd, line + "\n")) break;
+        reply.clear();
+        while (recv(fd, &c, 1, 0) == 1 && c != '\n') reply += c;
+        std::cout << reply << "\n";
+        if (line == "QUIT") break;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * Runs many sessions concurrently from one thread and reports the request rate.
+ */
+int loadTest(const std::string &path, int sessionCount, int rounds, const std::string &account) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<ClientSession> sessions(sessionCount);
+    const int steps = 1 + 3 * rounds;
+    auto start = Clock::now();
+    for (int i = 0; i < sessionCount; ++i) {
+        sessions[i].fd = connectTo(path, true);
+        if (sessions[i].fd < 0) {
+            std::cerr << "Could not open session " << i << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &sessions[i];
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, sessions[i].fd, &event);
+        sendAll(sessions[i].fd, request(0, account));
+    }
+
+    long long errors = 0;
+    int finished = 0;
+    epoll_event events[256];
+    char buffer[4096];
+    while (finished < sessionCount) {
+        int ready = epoll_wait(epollFd, events, 256, -1);
+        for (int i = 0; i < ready; ++i) {
+            ClientSession &session = *static_cast<ClientSession*>(events[i].data.ptr);
+            ssize_t received = recv(session.fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                if (received < 0 && errno == EAGAIN) continue;
+                std::cerr << "Session closed by the server\n";
+                return 1;
+            }
+            session.input.append(buffer, received);
+            std::size_t end;
+            while ((end = session.input.find('\n')) != std::string::npos) {
+                if (session.input.compare(0, 2, "OK") != 0) ++errors;
+                session.input.erase(0, end + 1);
+                if (++session.step == steps) {
+                    close(session.fd); // Also removes it from the epoll instance
+                    ++finished;
+                } else {
+                    sendAll(session.fd, request(session.step, account));
+                }
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    long long requests = (long long)sessionCount * steps;
+    std::cout << sessionCount << " sessions, " << requests << " requests in " << seconds << " s: "
+              << requests / seconds << " requests/s, " << errors << " errors\n";
+    close(epollFd);
+    return errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <socket> [--sessions N] [--rounds R] [--account ID]\n";
+        return 2;
+    }
+    int sessionCount = 0, rounds = 10;
+    std::string account = "1111111";
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--sessions") sessionCount = std::stoi(argv[i + 1]);
+        else if (option == "--rounds") rounds = std::stoi(argv[i + 1]);
+        else if (option == "--account") account = argv[i + 1];
+    }
+    if (sessionCount > 0) return loadTest(argv[1], sessionCount, rounds, account);
+    return interactive(argv[1]);
+}
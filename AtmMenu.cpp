@@ -0,0 +1,252 @@
+#include "AtmMenu.h"
+
+// Escape sequence that clears a terminal, here or at the other end of a socket.
+const char *const CLEAR_SCREEN = "\033[H\033[2J";
+
+AtmMenu::AtmMenu(Bank &bank, bool remote) : bank(bank), remote(remote) {}
+
+MenuSession::Task AtmMenu::run(MenuSession &session) {
+    std::ostream &out = session.output();
+    out << CLEAR_SCREEN << "\033[34m\t\tWelcome to Dummy Bank! \033[0m\n"
+        << "Which role would you like to sign in as:\n1. Client \n2. Banker\n\n";
+    std::optional<std::string> line = co_await session.nextLine(); // Read user's choice.
+    if (!line) co_return;
+    int userType = 0;
+    utility.parseNumber(*line, userType);
+    out << CLEAR_SCREEN; // Clear the screen for clean output.
+    if (userType != 1 && userType != 2) {
+        out << "\033[31m Invalid choice.\n \033[0m"; // Display error for invalid choice.
+        co_return;
+    }
+
+    // Main interaction loop based on user role.
+    while (true) {
+        if (userType == 1) {
+            co_await clientMenu(session); // Execute client-specific actions.
+        } else {
+            co_await bankerMenu(session); // Execute banker-specific actions.
+            bank.compact(COMPACTION_SLICE); // Reclaim a bounded number of deleted accounts.
+        }
+        if (session.inputClosed()) co_return;
+        out << "Would you like to continue? Y or N\n";
+        line = co_await session.nextLine();
+        if (!line) co_return;
+        std::string_view selection = utility.trim(*line);
+        if (selection != "y" && selection != "Y") co_return; // Exit loop if no longer continue.
+        out << CLEAR_SCREEN;
+    }
+}
+
+MenuSession::Task AtmMenu::clientMenu(MenuSession &session) {
+    std::ostream &out = session.output();
+    // Client PIN authentication
+    out << "Enter your 4 digit pin: ";
+    std::optional<std::string> line = co_await session.nextLine();
+    if (!line) co_return;
+    if (!utility.isNumber(*line, PIN_LENGTH)) { // Validates the PIN length.
+        out << "\033[31m Invalid Entry. \033[0m\n";
+        co_return;
+    }
+
+    // Dummy account for fast testing purposes. In a real scenario, this would be replaced
+    // by an account lookup based on the authenticated client.
+    // The handle stays valid while other accounts are added, deleted or sorted.
+    AccountHandle account = bank.findHandle(1111111);
+    if (bank.getAccount(account) == nullptr) {
+        out << "\033[31mAccount not found.\n\033[0m";
+        co_return; // Exit if account is not found.
+    }
+
+    // Client operations menu
+    out << "1. Check Balance\n2. Deposit Money\n3. Withdraw Money\nEnter choice: ";
+    line = co_await session.nextLine();
+    if (!line) co_return;
+    int choice = 0;
+    utility.parseNumber(*line, choice);
+    out << CLEAR_SCREEN; // Clears the screen for clean output.
+
+    Money amount; // Variable to store the amount for transactions.
+    std::uint64_t sequence; // Log record of a deposit or withdrawal
+    bool done;
+    switch (choice) {
+        case 1:
+            // Display the current account balance.
+            if (bank.checkBalance(account, amount)) {
+                out << "Your balance is: \033[32m$" << amount << "\n\033[0m";
+            }
+            break;
+        case 2:
+            // Handle deposit operation.
+            out << "Enter deposit amount: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            amount = utility.parseAmount(*line);
+            done = bank.deposit(account, amount, &sequence); // Deposit the specified amount.
+            if (done) co_await awaitCommit(session, sequence, done);
+            if (!done) {
+                out << "\033[31mInvalid amount.\n\033[0m";
+            }
+            break;
+        case 3:
+            // Handle withdrawal operation.
+            out << "Enter withdrawal amount: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            amount = utility.parseAmount(*line);
+            if (amount < Money()) {
+                out << "\033[31mInvalid amount.\n\033[0m";
+                break;
+            }
+            done = bank.withdraw(account, amount, &sequence);
+            if (done) co_await awaitCommit(session, sequence, done);
+            if (!done) {
+                out << "\033[31mInsufficient funds.\n\033[0m";
+            }
+            break;
+        default:
+            // Handle invalid choice.
+            out << "\033[31mInvalid choice.\n\033[0m";
+    }
+}
+
+MenuSession::Task AtmMenu::bankerMenu(MenuSession &session) {
+    std::ostream &out = session.output();
+    out << "1. Display all customers\n2. Delete an account\n3. Add a new account\n"
+        << "4. Search by name\n5. Search by balance greater than\n"
+        << "6. Sort accounts by name\n7. Sort accounts by balance\n"
+        << "8. Sort accounts by ID\n9. Search by balance range\n10. Save a snapshot\nEnter choice: ";
+    std::optional<std::string> line = co_await session.nextLine();
+    if (!line) co_return;
+    int choice = 0;
+    utility.parseNumber(*line, choice); // Gets the choice of the banker
+
+    // Variables to hold account details
+    std::optional<std::string> accountId, name;
+    Money balance, maxBalance;
+    std::uint64_t sequence; // Log record of an addition or deletion
+    bool done;
+
+    switch (choice) {
+        case 1:
+            // Display all bank accounts
+            bank.displayAccounts(out);
+            break;
+        case 2:
+            // Delete an account by its ID
+            out << "Enter account ID to delete: ";
+            accountId = co_await session.nextLine();
+            if (!accountId) co_return;
+            if (!utility.isNumber(*accountId, ACCOUNT_LENGTH)) {
+                out << "\033[31m Invalid Entry. \033[0m\n";
+                break;
+            }
+            done = bank.deleteAccount(std::stoi(*accountId), &sequence);
+            if (done) co_await awaitCommit(session, sequence, done);
+            if (done) {
+                out << "\033[32mAccount successfully deleted.\n\033[0m";
+            } else {
+                out << "\033[31mAccount not found.\n\033[0m";
+            }
+            break;
+        case 3:
+            // Add a new account
+            out << "Enter new account ID (7 digits): ";
+            accountId = co_await session.nextLine();
+            if (!accountId) co_return;
+            if (!utility.isNumber(*accountId, ACCOUNT_LENGTH)) {
+                out << "\033[31m Invalid Entry. \033[0m\n";
+                break;
+            }
+            out << "Enter initial Balance: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            balance = utility.parseAmount(*line);
+            if (balance >= Money()) {
+                out << "Enter the Name of the Client: ";
+                name = co_await session.nextLine();
+                if (!name) co_return;
+                done = bank.addAccount(Account(std::stoi(*accountId), balance, utility.trim(*name)), &sequence);
+                if (done) co_await awaitCommit(session, sequence, done);
+            } else {
+                out << "\033[31mInvalid amount.\n\033[0m";
+            }
+            break;
+        case 4:
+            // Search accounts by name
+            out << "Enter name to search: ";
+            name = co_await session.nextLine();
+            if (!name) co_return;
+            if (!utility.trim(*name).empty()) {
+                bank.displayAccountsByName(std::string(utility.trim(*name)), out);
+            } else {
+                out << "\033[31mName cannot be empty.\n\033[0m";
+            }
+            break;
+        case 5:
+            // Search accounts by a minimum balance
+            out << "Enter minimum balance: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            balance = utility.parseAmount(*line);
+            if (balance >= Money()) {
+                bank.displayAccountsByBalance(balance, out);
+            } else {
+                out << "\033[31mInvalid amount.\n\033[0m";
+            }
+            break;
+        case 6:
+            // Sort and display accounts by name
+            bank.sortAccountsByName();
+            bank.displayAccounts(out);
+            break;
+        case 7:
+            // Sort and display accounts by balance
+            bank.sortAccountsByBalance();
+            bank.displayAccounts(out);
+            break;
+        case 8:
+            // Sort and display accounts by ID
+            bank.sortAccountsById();
+            bank.displayAccounts(out);
+            break;
+        case 9:
+            // Search accounts with a balance in [minimum, maximum)
+            out << "Enter minimum balance: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            balance = utility.parseAmount(*line);
+            out << "Enter maximum balance (exclusive): ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            maxBalance = utility.parseAmount(*line);
+            if (balance >= Money() && maxBalance >= balance) {
+                bank.displayAccountsByBalance(balance, maxBalance, out);
+            } else {
+                out << "\033[31mInvalid amount.\n\033[0m";
+            }
+            break;
+        case 10:
+            // Save every account to a snapshot file for a fast restart
+            if (remote) {
+                // A remote user must not be able to overwrite files on the server.
+                out << "\033[31mSnapshots can only be saved from the console.\n\033[0m";
+                break;
+            }
+            out << "Enter snapshot file path: ";
+            line = co_await session.nextLine();
+            if (!line) co_return;
+            if (bank.saveSnapshot(std::string(utility.trim(*line))))
+                out << "\033[32mSnapshot saved.\n\033[0m";
+            else
+                out << "\033[31mCould not write the snapshot.\n\033[0m";
+            break;
+        default:
+            // Handle invalid choice
+            out << "\033[31mInvalid choice.\n\033[0m";
+    }
+}
+
+MenuSession::Task AtmMenu::awaitCommit(MenuSession &session, std::uint64_t sequence, bool &done) {
+    co_await session.commit(sequence);
+    done = bank.finishMutation(sequence);
+}
@@ -0,0 +1,64 @@
+#ifndef ATM_MENU_H
+#define ATM_MENU_H
+
+#include <cstddef>
+#include <string>
+#include "Bank.h"
+#include "MenuSession.h"
+#include "Utility.h"
+
+// The AtmMenu class holds the client and banker menus of the application, written as
+// coroutines over a MenuSession. Each menu reads its answers a line at a time with
+// co_await and suspends in between, so the same flows serve the console, where one
+// session is fed from standard input, and the ATM server, where one thread feeds
+// many sessions from their sockets.
+class AtmMenu {
+public:
+    /**
+     * Constructor to create the menus for a bank
+     * @param bank The bank every session works against; it must outlive the menus.
+     * @param remote Whether the sessions come from remote users, who may not use the
+     * options that touch the file system.
+    */
+    explicit AtmMenu(Bank &bank, bool remote = false);
+
+    /**
+     * Runs a whole session: asks for the user's role, then repeats the client or
+     * banker menu for as long as the user wants to continue.
+     * @param session The session to read from and write to; it must outlive the flow.
+     * @return The flow, to be started with MenuSession::start().
+    */
+    MenuSession::Task run(MenuSession &session);
+
+private:
+    static const int ACCOUNT_LENGTH = 7;                // Digits in an account number
+    static const int PIN_LENGTH = 4;                    // Digits in a PIN
+    static const std::size_t COMPACTION_SLICE = 1024;   // Deleted accounts reclaimed between two banker actions
+
+    /**
+     * Helper function to run the client menu once: PIN check, then one operation on the account
+     * @param session The session to read from and write to
+    */
+    MenuSession::Task clientMenu(MenuSession &session);
+
+    /**
+     * Helper function to run the banker menu once: one administrative operation
+     * @param session The session to read from and write to
+    */
+    MenuSession::Task bankerMenu(MenuSession &session);
+
+    /**
+     * Helper function to wait, without blocking the thread, for the commit of a
+     * mutation made with a sequence pointer, then finish it
+     * @param session The session whose flow waits
+     * @param sequence The mutation's log sequence number
+     * @param done Set to whether the mutation is durable; it was undone if not
+    */
+    MenuSession::Task awaitCommit(MenuSession &session, std::uint64_t sequence, bool &done);
+
+    Bank &bank;         // Shared by every session
+    bool remote;        // Sessions come from a socket, not the console
+    Utility utility;    // Parses the lines the sessions read
+};
+
+#endif // ATM_MENU_H
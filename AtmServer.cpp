@@ -0,0 +1,367 @@
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "AtmServer.h"
+
+// Number of ready events each epoll_wait() call collects.
+const int EPOLL_BATCH = 64;
+
+/**
+ * Splits the first space-separated word off a request.
+ * @param text The rest of the request; the word and its leading spaces are removed.
+ * @return The word, empty if none is left.
+ */
+static std::string_view nextWord(std::string_view &text) {
+    std::size_t start = text.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        text = std::string_view();
+        return text;
+    }
+    std::size_t end = text.find(' ', start);
+    if (end == std::string_view::npos) end = text.size();
+    std::string_view word = text.substr(start, end - start);
+    text.remove_prefix(end);
+    return word;
+}
+
+/**
+ * Parses an account id that makes up the whole of a word.
+ * @return true if the word is a valid id, false otherwise.
+ */
+static bool parseAccountId(std::string_view word, int &id) {
+    auto [ptr, error] = std::from_chars(word.data(), word.data() + word.size(), id);
+    return error == std::errc() && ptr == word.data() + word.size() && !word.empty();
+}
+
+AtmServer::AtmServer(Bank &bank, std::size_t workers, Protocol protocol)
+    : bank(bank), workerCount(workers ? workers : 1), protocol(protocol), menus(bank, true) {}
+
+AtmServer::~AtmServer() {
+    {
+        // The log calls back into the server for every session set aside.
+        std::unique_lock<std::mutex> lock(committedMutex);
+        settled.wait(lock, [this] { return awaiting == 0; });
+    }
+    for (Session *session : sessions) {
+        ::close(session->fd);
+        delete session;
+    }
+    if (listenFd >= 0) ::close(listenFd);
+    if (epollFd >= 0) ::close(epollFd);
+    if (stopFd >= 0) ::close(stopFd);
+    if (commitFd >= 0) ::close(commitFd);
+    if (spareFd >= 0) ::close(spareFd);
+    if (!socketPath.empty()) unlink(socketPath.c_str());
+}
+
+bool AtmServer::listen(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) return false;
+    unlink(path.c_str()); // A socket file left behind by an earlier run
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) return false;
+    socketPath = path;
+    if (::listen(listenFd, SOMAXCONN) < 0) return false;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    commitFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    spareFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (epollFd < 0 || stopFd < 0 || commitFd < 0 || spareFd < 0) return false;
+    // All three stay level-triggered: every worker sees the stop event, and any idle
+    // worker may accept or resume sessions whose commits settled.
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = &listenFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) < 0) return false;
+    event.data.ptr = &stopFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event) < 0) return false;
+    event.data.ptr = &commitFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, commitFd, &event) == 0;
+}
+
+void AtmServer::run() {
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < workerCount; ++i) {
+        workers.emplace_back([this] { work(); });
+    }
+    work();
+    for (auto &worker : workers) worker.join();
+}
+
+void AtmServer::stop() {
+    std::uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) < 0) perror("AtmServer::stop");
+}
+
+std::size_t AtmServer::sessionCount() const {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    return sessions.size();
+}
+
+void AtmServer::work() {
+    epoll_event events[EPOLL_BATCH];
+    while (true) {
+        int ready = epoll_wait(epollFd, events, EPOLL_BATCH, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        for (int i = 0; i < ready; ++i) {
+            void *source = events[i].data.ptr;
+            if (source == &stopFd) return; // Sessions left unarmed are closed by the destructor.
+            if (source == &listenFd) {
+                acceptSessions();
+            } else if (source == &commitFd) {
+                resumeCommitted();
+            } else {
+                serve(*static_cast<Session*>(source));
+            }
+        }
+    }
+}
+
+void AtmServer::acceptSessions() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            // The listener stays readable while a connection waits, so one that cannot
+            // get a descriptor must be refused, or every worker would spin on it.
+            if (errno == EMFILE || errno == ENFILE) refuseConnection();
+            return;
+        }
+        Session *session = new Session(fd);
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex);
+            sessions.insert(session);
+        }
+        if (protocol == Protocol::Menus) {
+            // Run the menus up to their first question and send the welcome screen.
+            session->menu = std::make_unique<MenuSession>();
+            session->menu->start(menus.run(*session->menu));
+            session->output = session->menu->takeOutput();
+            if (!flush(*session)) {
+                closeSession(session);
+                continue;
+            }
+        }
+        epoll_event event{};
+        event.events = (session->output.empty() ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+        event.data.ptr = session;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) closeSession(session);
+    }
+}
+
+void AtmServer::refuseConnection() {
+    std::lock_guard<std::mutex> lock(spareMutex);
+    if (spareFd < 0) return;
+    ::close(spareFd);
+    int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) ::close(fd);
+    spareFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void AtmServer::serve(Session &session) {
+    if (!flush(session)) {
+        closeSession(&session);
+        return;
+    }
+    // Stop reading while replies pile up unsent, so a client that never reads them
+    // cannot grow the output without bound.
+    char buffer[4096];
+    bool hungUp = false;
+    // A session waiting for a commit reads no further, so its requests stay in order.
+    while (!hungUp && !session.closing && session.committing == 0 && session.output.size() < MAX_OUTPUT) {
+        ssize_t received = read(session.fd, buffer, sizeof(buffer));
+        if (received == 0) {
+            hungUp = true; // The client is done; answer what it sent first.
+        } else if (received < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeSession(&session);
+                return;
+            }
+        } else {
+            session.input.append(buffer, received);
+        }
+        // Answer every complete line, so the input never holds more than one.
+        std::size_t start = 0, end;
+        while (!session.closing && session.committing == 0 && (end = session.input.find('\n', start)) != std::string::npos) {
+            std::string_view line(session.input.data() + start, end - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (session.menu) {
+                session.menu->deliver(std::string(line));
+                session.output += session.menu->takeOutput();
+                session.committing = session.menu->awaitedCommit();
+                if (session.menu->finished()) session.closing = true;
+            } else {
+                std::string reply = handle(session, line);
+                if (session.committing == 0) {
+                    session.output += reply;
+                    session.output += '\n';
+                }
+            }
+            start = end + 1;
+        }
+        session.input.erase(0, start);
+        if (session.input.size() > MAX_LINE) {
+            session.output += "ERR line too long\n";
+            session.closing = true;
+        }
+        if (received < 0) break;
+    }
+    if (session.committing != 0) {
+        awaitCommit(session); // Read again, and see a hang-up again, once resumed.
+        return;
+    }
+    if (hungUp) session.closing = true;
+    if (!flush(session) || (session.closing && session.output.empty())) {
+        closeSession(&session);
+        return;
+    }
+    epoll_event event{};
+    event.events = (session.output.empty() ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+    event.data.ptr = &session;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event) < 0) closeSession(&session);
+}
+
+std::string AtmServer::handle(Session &session, std::string_view line) {
+    std::string_view rest = line;
+    std::string_view command = nextWord(rest);
+    int id;
+    Money amount;
+
+    if (command == "BAL" || command == "DEP" || command == "WD") {
+        if (session.account.isNull()) return "ERR not logged in";
+        if (command == "BAL") {
+            if (!bank.checkBalance(session.account, amount)) return "ERR account not found";
+            return "OK " + amount.toString();
+        }
+        if (!Money::parse(nextWord(rest), amount) || amount < Money()) return "ERR invalid amount";
+        std::uint64_t sequence;
+        bool done = command == "DEP" ? bank.deposit(session.account, amount, &sequence)
+                                     : bank.withdraw(session.account, amount, &sequence);
+        if (done) return replyWhenDurable(session, sequence);
+        if (!bank.checkBalance(session.account, amount)) return "ERR account not found";
+        return command == "DEP" ? "ERR deposit refused" : "ERR insufficient funds";
+    }
+    if (command == "LOGIN") {
+        if (!parseAccountId(nextWord(rest), id)) return "ERR invalid account";
+        AccountHandle account = bank.findHandle(id);
+        if (account.isNull()) return "ERR account not found";
+        session.account = account; // Stays valid while other accounts come and go
+        return "OK";
+    }
+    if (command == "ADD") {
+        if (!parseAccountId(nextWord(rest), id)) return "ERR invalid account";
+        if (!Money::parse(nextWord(rest), amount) || amount < Money()) return "ERR invalid amount";
+        std::size_t start = rest.find_first_not_of(' ');
+        if (start == std::string_view::npos) return "ERR missing name";
+        std::uint64_t sequence;
+        if (!bank.addAccount(Account(id, amount, rest.substr(start)), &sequence)) return "ERR account exists";
+        return replyWhenDurable(session, sequence);
+    }
+    if (command == "DEL") {
+        if (!parseAccountId(nextWord(rest), id)) return "ERR invalid account";
+        std::uint64_t sequence;
+        if (!bank.deleteAccount(id, &sequence)) return "ERR account not found";
+        return replyWhenDurable(session, sequence);
+    }
+    if (command == "TOTAL") {
+        Money total;
+        if (!bank.totalBalance(total)) return "ERR total overflows";
+        return "OK " + total.toString();
+    }
+    if (command == "QUIT") {
+        session.closing = true;
+        return "OK";
+    }
+    return "ERR unknown command";
+}
+
+std::string AtmServer::replyWhenDurable(Session &session, std::uint64_t sequence) {
+    if (sequence == 0) return "OK";
+    session.committing = sequence;
+    return std::string();
+}
+
+void AtmServer::awaitCommit(Session &session) {
+    {
+        std::lock_guard<std::mutex> lock(committedMutex);
+        ++awaiting;
+    }
+    // Runs on the log's flusher thread, so it only queues the session and wakes a worker.
+    bank.whenDurable(session.committing, [this, &session] {
+        std::lock_guard<std::mutex> lock(committedMutex);
+        committed.push_back(&session);
+        std::uint64_t one = 1;
+        if (write(commitFd, &one, sizeof(one)) < 0) perror("AtmServer::awaitCommit");
+        --awaiting;
+        settled.notify_all();
+    });
+}
+
+void AtmServer::resumeCommitted() {
+    std::vector<Session*> ready;
+    {
+        std::lock_guard<std::mutex> lock(committedMutex);
+        std::uint64_t count;
+        if (read(commitFd, &count, sizeof(count)) < 0 && errno != EAGAIN) perror("AtmServer::resumeCommitted");
+        ready.swap(committed);
+    }
+    for (Session *session : ready) {
+        if (session->menu) {
+            // The flow finishes the mutation itself, then runs on to its next question.
+            session->menu->committed();
+            session->output += session->menu->takeOutput();
+            session->committing = session->menu->awaitedCommit();
+            if (session->menu->finished()) session->closing = true;
+        } else {
+            bool durable = bank.finishMutation(session->committing);
+            session->committing = 0;
+            session->output += durable ? "OK\n" : "ERR not logged\n";
+        }
+        if (session->committing != 0) awaitCommit(*session);
+        else serve(*session);
+    }
+}
+
+bool AtmServer::flush(Session &session) {
+    std::size_t sent = 0;
+    while (sent < session.output.size()) {
+        // MSG_NOSIGNAL: a client that hung up is an error here, not a SIGPIPE.
+        ssize_t written = send(session.fd, session.output.data() + sent, session.output.size() - sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += written;
+    }
+    session.output.erase(0, sent);
+    return true;
+}
+
+void AtmServer::closeSession(Session *session) {
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions.erase(session);
+    }
+    ::close(session->fd); // Also removes it from the epoll instance
+    delete session;
+}
@@ -0,0 +1,157 @@
+#ifndef ATM_SERVER_H
+#define ATM_SERVER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "AtmMenu.h"
+#include "Bank.h"
+
+// The AtmServer class serves many ATM sessions at once against one shared Bank,
+// over a Unix domain socket. Each connection is a session speaking a line protocol;
+// every request is one line and gets exactly one reply line, "OK ..." or "ERR ...":
+//
+//   LOGIN <id>                    Selects the session's account      -> OK
+//   BAL                           Balance of the session's account   -> OK <balance>
+//   DEP <amount>                  Deposit into it                    -> OK
+//   WD <amount>                   Withdraw from it                   -> OK
+//   ADD <id> <balance> <name>     Opens an account (admin)           -> OK
+//   DEL <id>                      Deletes an account (admin)         -> OK
+//   TOTAL                         Sum of every balance (admin)       -> OK <total>
+//   QUIT                          Closes the session
+//
+// Started with Protocol::Menus instead, each connection runs the interactive client
+// and banker menus of the console application, as an AtmMenu coroutine that the
+// workers resume whenever a line arrives; the session closes when the menus end.
+//
+// Sockets are non-blocking and multiplexed with epoll. A few worker threads wait on
+// the same epoll instance; each connection is armed one-shot, so only one worker
+// handles it at a time. With a write-ahead log open, a mutating request is answered
+// once its record is on disk, but no worker waits for that: the session is set
+// aside until the log's flusher hands it back through an eventfd, so any number of
+// sessions share each group commit while the workers serve the others. A failed
+// commit is undone and answered "ERR not logged". A menu session is set aside the
+// same way while its flow waits in MenuSession::commit().
+class AtmServer {
+public:
+    // What the sessions speak.
+    enum class Protocol { Requests, Menus };
+
+    /**
+     * Constructor to create a server for a bank
+     * @param bank The bank every session works against; it must outlive the server.
+     * @param workers The number of threads running the event loop.
+     * @param protocol The request protocol above, or the interactive menus.
+    */
+    AtmServer(Bank &bank, std::size_t workers, Protocol protocol = Protocol::Requests);
+    ~AtmServer();
+    AtmServer(const AtmServer&) = delete;
+    AtmServer& operator=(const AtmServer&) = delete;
+
+    /**
+     * Starts listening on a Unix domain socket, replacing a stale socket file.
+     * @param socketPath The path of the socket file.
+     * @return true if the server is listening, false otherwise.
+    */
+    bool listen(const std::string &socketPath);
+
+    // Runs the event loop on the worker threads until stop() is called.
+    void run();
+
+    // Makes run() return once the workers have finished their current requests. Safe to call from any thread.
+    void stop();
+
+    // Returns the number of sessions currently connected.
+    std::size_t sessionCount() const;
+
+private:
+    // The state of one connection.
+    struct Session {
+        // Creates the state of a connection that was just accepted.
+        explicit Session(int fd) : fd(fd) {}
+
+        int fd;                     // The connection's socket
+        AccountHandle account;      // Set by LOGIN
+        std::unique_ptr<MenuSession> menu; // The menus' coroutine state, with Protocol::Menus
+        std::string input;          // Bytes received but not yet handled
+        std::string output;         // Replies not yet sent
+        std::uint64_t committing = 0; // Log sequence the session waits for before it goes on, or 0
+        bool closing = false;       // Close once the output is sent
+    };
+
+    static const std::size_t MAX_LINE = 1024;        // Longest request line accepted
+    static const std::size_t MAX_OUTPUT = 64 * 1024; // Unsent reply bytes at which reading pauses
+
+    // Helper function to run the event loop on one thread
+    void work();
+
+    // Helper function to accept every pending connection
+    void acceptSessions();
+
+    /**
+     * Helper function to read and answer everything a session has sent, then re-arm it
+     * @param session The session whose socket is ready
+    */
+    void serve(Session &session);
+
+    /**
+     * Helper function to answer one request line
+     * @param session The session that sent it
+     * @param line The request, without the line break
+     * @return The reply, without the line break, or nothing if it waits for the
+     * commit of the session's mutation
+    */
+    std::string handle(Session &session, std::string_view line);
+
+    /**
+     * Helper function to reply to a mutation that was made, now or once it is durable
+     * @param session The session that asked for it
+     * @param sequence The mutation's log sequence number, or 0 if no log is open
+     * @return "OK", or nothing if the reply waits for the commit
+    */
+    std::string replyWhenDurable(Session &session, std::uint64_t sequence);
+
+    // Helper function to set a session aside until its mutation's commit is settled
+    void awaitCommit(Session &session);
+
+    // Helper function to reply to, and go on serving, every session whose commit is settled
+    void resumeCommitted();
+
+    // Helper function to refuse one pending connection when out of descriptors
+    void refuseConnection();
+
+    /**
+     * Helper function to send as much pending output as the socket accepts
+     * @return false if the connection failed
+    */
+    bool flush(Session &session);
+
+    // Helper function to close a session and free its state
+    void closeSession(Session *session);
+
+    Bank &bank;                              // Shared by every session
+    std::size_t workerCount;                 // Threads running the event loop
+    Protocol protocol;                       // What the sessions speak
+    AtmMenu menus;                           // The flows run by menu sessions
+    int listenFd = -1;                       // The listening socket
+    int epollFd = -1;                        // Watches the listener, the sessions and stopFd
+    int stopFd = -1;                         // An eventfd that becomes readable on stop()
+    int commitFd = -1;                       // An eventfd that becomes readable when commits settle
+    std::mutex spareMutex;                   // Guards spareFd
+    int spareFd = -1;                        // Given up to refuse connections when out of descriptors
+    std::mutex committedMutex;               // Guards committed and awaiting
+    std::condition_variable settled;         // Signalled when awaiting drops
+    std::vector<Session*> committed;         // Sessions whose commit settled, not yet resumed
+    std::size_t awaiting = 0;                // Sessions set aside whose commit has not settled
+    std::string socketPath;                  // Removed again by the destructor
+    mutable std::mutex sessionsMutex;        // Guards sessions
+    std::unordered_set<Session*> sessions;   // Every open session
+};
+
+#endif // ATM_SERVER_H
@@ -0,0 +1,61 @@
+#include <iterator>
+#include <limits>
+#include "BalanceIndex.h"
+#include "ParallelSort.h"
+
+void BalanceIndex::add(std::uint32_t slot, Money balance) {
+    entries.emplace(balance, slot);
+}
+
+void BalanceIndex::addBatch(std::vector<std::pair<Money, std::uint32_t>> batch) {
+    ParallelSort::sort(batch);
+    auto hint = entries.begin();
+    for (const auto &entry : batch) {
+        hint = std::next(entries.insert(hint, entry));
+    }
+}
+
+void BalanceIndex::remove(std::uint32_t slot, Money balance) {
+    entries.erase({balance, slot});
+}
+
+void BalanceIndex::update(std::uint32_t slot, Money oldBalance, Money newBalance) {
+    if (oldBalance == newBalance) return;
+    // Reuse the tree node instead of freeing and allocating one.
+    auto node = entries.extract({oldBalance, slot});
+    if (node.empty()) return;
+    node.value().first = newBalance;
+    entries.insert(std::move(node));
+}
+
+void BalanceIndex::clear() {
+    entries.clear();
+}
+
+std::vector<std::uint32_t> BalanceIndex::slotsAbove(Money minBalance) const {
+    std::vector<std::uint32_t> slots;
+    // Skip every entry whose balance equals minBalance, whatever its slot.
+    auto it = entries.upper_bound({minBalance, std::numeric_limits<std::uint32_t>::max()});
+    for (; it != entries.end(); ++it) {
+        slots.push_back(it->second);
+    }
+    return slots;
+}
+
+std::vector<std::uint32_t> BalanceIndex::slotsInRange(Money low, Money high) const {
+    std::vector<std::uint32_t> slots;
+    auto it = entries.lower_bound({low, 0});
+    for (; it != entries.end() && it->first < high; ++it) {
+        slots.push_back(it->second);
+    }
+    return slots;
+}
+
+std::vector<std::uint32_t> BalanceIndex::slots() const {
+    std::vector<std::uint32_t> slots;
+    slots.reserve(entries.size());
+    for (const auto &entry : entries) {
+        slots.push_back(entry.second);
+    }
+    return slots;
+}
@@ -0,0 +1,69 @@
+#ifndef BALANCE_INDEX_H
+#define BALANCE_INDEX_H
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+#include "Money.h"
+
+// The BalanceIndex class keeps account slots ordered by (balance, slot) in a balanced
+// search tree. Range queries find their first entry in O(log n) and then walk
+// only the k matching entries.
+class BalanceIndex {
+public:
+    /**
+     * Adds an account to the index.
+     * @param slot The account's slot in the AccountStore.
+     * @param balance The account's current balance.
+    */
+    void add(std::uint32_t slot, Money balance);
+
+    /**
+     * Removes an account from the index.
+     * @param slot The account's slot in the AccountStore.
+     * @param balance The balance the account is currently indexed under.
+    */
+    void remove(std::uint32_t slot, Money balance);
+
+    /**
+     * Moves an account to a new position after its balance changed.
+     * @param slot The account's slot in the AccountStore.
+     * @param oldBalance The balance the account is currently indexed under.
+     * @param newBalance The account's new balance.
+    */
+    void update(std::uint32_t slot, Money oldBalance, Money newBalance);
+
+    /**
+     * Adds many accounts at once. Sorting the batch first lets every insert use
+     * the previous position as a hint, which is linear when the index starts empty.
+     * @param batch (balance, slot) pairs for accounts that are not indexed yet.
+    */
+    void addBatch(std::vector<std::pair<Money, std::uint32_t>> batch);
+
+    // Removes every entry.
+    void clear();
+
+    /**
+     * Collects the accounts whose balance is strictly greater than a minimum.
+     * @param minBalance The exclusive lower bound.
+     * @return The matching slots in ascending balance order.
+    */
+    std::vector<std::uint32_t> slotsAbove(Money minBalance) const;
+
+    /**
+     * Collects the accounts whose balance lies in the half-open range [low, high).
+     * @param low The inclusive lower bound.
+     * @param high The exclusive upper bound.
+     * @return The matching slots in ascending balance order.
+    */
+    std::vector<std::uint32_t> slotsInRange(Money low, Money high) const;
+
+    // Returns every slot in ascending balance order.
+    std::vector<std::uint32_t> slots() const;
+
+private:
+    std::set<std::pair<Money, std::uint32_t>> entries; // (balance, slot) pairs in ascending order
+};
+
+#endif // BALANCE_INDEX_H
@@ -1,83 +1,937 @@
+#include <fstream>
+#include <memory>
+#include <thread>
 #include "Bank.h"
+#include "NamePool.h"
+#include "ParallelSort.h"
 
 const char FILLER = '-';
 const short int COL_WIDTH = 20;
 
-bool Bank::addAccount(const Account &account) {
-    if(findAccount(account.getId()) != nullptr) return false;
-    accounts.push_back(account);
+// Number of tombstones every addAccount() reclaims before inserting.
+const std::size_t ADD_COMPACTION_SLICE = 4;
+
+// Number of delta snapshots after which checkpoint() merges them into the base.
+const std::size_t MERGE_DELTA_COUNT = 8;
+
+Bank::Bank(ConcurrencyMode mode) : mode(mode) {}
+
+bool Bank::openSnapshot(const std::string &path) {
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    if (!slotById.empty() || snapshotPending != 0) return false;
+    if (!snapshot.open(path)) return false;
+    // Every delta must open before any is applied: skipping one would silently lose
+    // its changes, and the ones after it build on it.
+    std::vector<std::unique_ptr<Snapshot>> deltas;
+    for (const auto &entry : SnapshotMerger::deltas(path)) {
+        if (entry.first <= snapshot.logSequence()) continue; // Already merged into the base
+        deltas.push_back(std::make_unique<Snapshot>());
+        if (!deltas.back()->open(entry.second)) {
+            snapshot.close();
+            return false;
+        }
+    }
+    snapshotClaimed.clear(); // Allocated on the first claim, so opening stays O(1).
+    snapshotPending = snapshot.size();
+    snapshotSequence = snapshot.logSequence();
+    for (const auto &delta : deltas) {
+        applyDelta(*delta);
+        snapshotSequence = delta->logSequence();
+    }
+    clearDirty(); // The deltas are already on disk.
+    checkpointBase = path;
     return true;
 }
 
-void Bank::displayAccounts() {
-    displayAccountsFormatted(accounts);
+void Bank::applyDelta(const Snapshot &delta) {
+    std::uint64_t unlogged;
+    for (std::size_t i = 0; i < delta.deletedCount(); ++i) {
+        deleteAccountLocked(delta.deletedAt(i), unlogged);
+    }
+    for (std::size_t i = 0; i < delta.size(); ++i) {
+        AccountRow row = delta.row(i);
+        deleteAccountLocked(row.id, unlogged); // Replace the older version, if any.
+        addAccountLocked(Account(row.id, row.balance, row.name), unlogged);
+    }
+}
+
+bool Bank::saveSnapshot(const std::string &path) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    // The snapshot claims every logged mutation, so each must be durable or undone.
+    if (!settleLog()) return false;
+    return saveSnapshotLocked(path);
+}
+
+bool Bank::saveSnapshotLocked(const std::string &path) {
+    std::vector<std::uint32_t> slots = views.slotsById();
+    std::size_t next = 0;
+    auto nextRow = [&](AccountRow &row) {
+        while (next < slots.size() && !store.isLive(slots[next])) ++next;
+        if (next == slots.size()) return false;
+        const Account &acc = store.at(slots[next++]);
+        row = AccountRow{acc.getId(), acc.getName(), acc.getBalance()};
+        return true;
+    };
+    merger.wait(); // A merge may be writing the same file.
+    return Snapshot::write(path, nextRow, {}, std::max(snapshotSequence, log.lastSequence()));
+}
+
+bool Bank::openLog(const std::string &path) {
+    // Replay goes through the public member functions, which take their own locks.
+    if (!log.open(path, snapshotSequence, [this](const LogRecord &record) { replay(record); })) return false;
+    logging = true;
+    return true;
+}
+
+bool Bank::checkpoint(const std::string &snapshotPath) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    if (!settleLog()) return false;
+    std::uint64_t sequence = std::max(snapshotSequence, log.lastSequence());
+    if (logging && snapshotPath == checkpointBase) {
+        // Sequence numbers only advance with a log, so each delta gets its own.
+        if (!writeDelta(snapshotPath, sequence)) return false;
+        if (SnapshotMerger::deltas(snapshotPath).size() >= MERGE_DELTA_COUNT) merger.start(snapshotPath);
+    } else {
+        if (!saveSnapshotLocked(snapshotPath)) return false;
+        SnapshotMerger::removeDeltas(snapshotPath, sequence);
+        checkpointBase = snapshotPath;
+    }
+    clearDirty();
+    // Appends happen under the table lock, so the log holds nothing newer than the checkpoint.
+    return !logging || log.truncate();
+}
+
+bool Bank::writeDelta(const std::string &basePath, std::uint64_t sequence) {
+    if (dirtySlots.empty() && deletedIds.empty()) return true;
+    std::vector<const Account*> changed;
+    for (std::uint32_t slot : dirtySlots) {
+        if (store.isLive(slot)) changed.push_back(&store.at(slot));
+    }
+    std::sort(changed.begin(), changed.end(), [](const Account *a, const Account *b) {
+        return a->getId() < b->getId();
+    });
+    std::sort(deletedIds.begin(), deletedIds.end());
+    deletedIds.erase(std::unique(deletedIds.begin(), deletedIds.end()), deletedIds.end());
+    std::size_t next = 0;
+    auto nextRow = [&](AccountRow &row) {
+        if (next == changed.size()) return false;
+        const Account *acc = changed[next++];
+        row = AccountRow{acc->getId(), acc->getName(), acc->getBalance()};
+        return true;
+    };
+    return Snapshot::write(SnapshotMerger::deltaPath(basePath, sequence), nextRow, deletedIds, sequence);
+}
+
+void Bank::markDirty(std::uint32_t slot) {
+    if (slot >= dirty.size()) dirty.resize(slot + 1, 0);
+    if (dirty[slot]) return;
+    dirty[slot] = 1;
+    dirtySlots.push_back(slot);
 }
 
-void Bank::displayAccountsFormatted(const std::vector<Account>& accounts) {
-    system("clear"); // Clear the console.    
+void Bank::clearDirty() {
+    for (std::uint32_t slot : dirtySlots) dirty[slot] = 0;
+    dirtySlots.clear();
+    deletedIds.clear();
+}
+
+bool Bank::logChange(PendingChange change, std::uint64_t &sequence) {
+    sequence = 0;
+    if (!logging) return true;
+    sequence = log.append(change.record);
+    if (sequence == 0) return false;
+    change.sequence = sequence;
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (pendingChanges.size() >= pendingPruneAt) {
+        // Forget the mutations that reached the disk, in amortized O(1).
+        std::uint64_t durable = log.lastDurable();
+        pendingChanges.erase(std::remove_if(pendingChanges.begin(), pendingChanges.end(),
+                                            [durable](const PendingChange &pending) { return pending.sequence <= durable; }),
+                             pendingChanges.end());
+        pendingPruneAt = std::max(MIN_PENDING_PRUNE, 2 * pendingChanges.size());
+    }
+    pendingChanges.push_back(change);
+    return true;
+}
+
+bool Bank::logWait(std::uint64_t sequence) {
+    if (!logging || log.waitDurable(sequence)) return true;
+    // The log failed before this record reached the disk. Later mutations may build on
+    // this one, and the log lost them too, so undo them all to match what recovery sees.
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    rollBackLostChanges();
+    return false;
+}
+
+void Bank::whenDurable(std::uint64_t sequence, std::function<void()> ready) {
+    if (sequence == 0) ready(); // Made without a log; nothing to wait for.
+    else log.whenDurable(sequence, std::move(ready));
+}
+
+bool Bank::finishMutation(std::uint64_t sequence) {
+    return sequence == 0 || logWait(sequence);
+}
+
+bool Bank::settleLog() {
+    if (!logging) return true;
+    if (!log.flush()) {
+        rollBackLostChanges();
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingChanges.clear(); // Every record is on disk.
+    return true;
+}
+
+void Bank::rollBackLostChanges() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    std::uint64_t durable = log.lastDurable();
+    // Newest first, so each mutation is undone on exactly the state it left behind.
+    std::sort(pendingChanges.begin(), pendingChanges.end(), [](const PendingChange &a, const PendingChange &b) {
+        return a.sequence > b.sequence;
+    });
+    for (const PendingChange &change : pendingChanges) {
+        if (change.sequence <= durable) break;
+        undoChange(change);
+    }
+    pendingChanges.clear();
+}
+
+void Bank::undoChange(const PendingChange &change) {
+    const LogRecord &record = change.record;
+    auto slotOf = [this](int id) {
+        auto it = slotById.find(id);
+        return it != slotById.end() ? it->second : UINT32_MAX;
+    };
+    std::uint32_t slot = slotOf(record.id);
+    switch (record.op) {
+        case LogOp::Deposit:
+        case LogOp::Withdraw: {
+            if (slot == UINT32_MAX) return;
+            Account &acc = store.at(slot);
+            noteBalanceChange(slot, acc);
+            if (record.op == LogOp::Deposit) acc.withdraw(record.amount);
+            else acc.deposit(record.amount);
+            break;
+        }
+        case LogOp::Transfer: {
+            std::uint32_t targetSlot = slotOf(record.target);
+            if (slot == UINT32_MAX || targetSlot == UINT32_MAX) return;
+            moveBalance(targetSlot, store.at(targetSlot), slot, store.at(slot), record.amount);
+            break;
+        }
+        case LogOp::Add:
+            if (slot != UINT32_MAX) dropAccount(slot);
+            break;
+        case LogOp::Delete: {
+            // The account comes back in a new slot; handles to the deleted one stay stale.
+            markDirty(insertAccount(Account(record.id, change.deletedBalance, change.deletedName)));
+            auto deleted = std::find(deletedIds.rbegin(), deletedIds.rend(), record.id);
+            if (deleted != deletedIds.rend()) deletedIds.erase(std::next(deleted).base());
+            break;
+        }
+    }
+}
+
+void Bank::replay(const LogRecord &record) {
+    switch (record.op) {
+        case LogOp::Deposit:
+            deposit(record.id, record.amount);
+            break;
+        case LogOp::Withdraw:
+            withdraw(record.id, record.amount);
+            break;
+        case LogOp::Add:
+            addAccount(Account(record.id, record.amount, record.name));
+            break;
+        case LogOp::Delete:
+            deleteAccount(record.id);
+            break;
+        case LogOp::Transfer:
+            transfer(record.id, record.target, record.amount);
+            break;
+    }
+}
+
+std::unique_lock<std::shared_mutex> Bank::lockForReport() {
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    loadSnapshot();
+    applyBalanceChanges();
+    return table;
+}
+
+std::size_t Bank::stripeIndex(std::uint32_t slot) const {
+    return mode == ConcurrencyMode::Mutex ? 0 : slot % BALANCE_STRIPES;
+}
+
+Bank::BalanceStripe& Bank::stripeFor(std::uint32_t slot) const {
+    return stripes[stripeIndex(slot)];
+}
+
+void Bank::lockStripes(std::uint32_t a, std::uint32_t b,
+                       std::unique_lock<std::mutex> &first, std::unique_lock<std::mutex> &second) const {
+    std::size_t low = std::min(stripeIndex(a), stripeIndex(b));
+    std::size_t high = std::max(stripeIndex(a), stripeIndex(b));
+    first = std::unique_lock<std::mutex>(stripes[low].mutex);
+    if (high != low) second = std::unique_lock<std::mutex>(stripes[high].mutex);
+}
+
+bool Bank::lockFree() const {
+    // Durable updates must reach the log in the order they were applied, which
+    // only a lock can guarantee, or replay could refuse a withdrawal that succeeded.
+    return mode == ConcurrencyMode::LockFree && !logging;
+}
+
+void Bank::noteBalanceChange(std::uint32_t slot, const Account &account) {
+    // Only the first change since the last report is recorded: the index still holds
+    // the balance from before it, and the latest one is read from the account when
+    // applying. The flag is set after the balance is read, so no update lands first.
+    if (__atomic_load_n(&balanceNoted[slot], __ATOMIC_ACQUIRE)) return;
+    BalanceStripe &stripe = stripeFor(slot);
+    std::unique_lock<std::mutex> lock;
+    if (lockFree()) lock = std::unique_lock<std::mutex>(stripe.mutex);
+    if (__atomic_load_n(&balanceNoted[slot], __ATOMIC_RELAXED)) return;
+    stripe.changed.emplace_back(slot, account.getBalance());
+    __atomic_store_n(&balanceNoted[slot], 1, __ATOMIC_RELEASE);
+}
+
+void Bank::applyBalanceChanges() {
+    for (BalanceStripe &stripe : stripes) {
+        for (const auto &[slot, oldBalance] : stripe.changed) {
+            balanceNoted[slot] = 0; // Updates wait for the exclusive lock, so no atomics needed.
+            // Retired accounts keep index entries until compact(), so those are fixed too.
+            Money balance = store.at(slot).getBalance();
+            balanceIndex.update(slot, oldBalance, balance);
+            if (!store.isLive(slot)) continue;
+            columns.setBalance(slot, balance);
+            markDirty(slot);
+        }
+        stripe.changed.clear();
+    }
+}
+
+std::size_t Bank::pendingSnapshotRow(int id) const {
+    if (snapshotPending == 0) return Snapshot::NOT_FOUND;
+    std::size_t row = snapshot.find(id);
+    if (row != Snapshot::NOT_FOUND && !snapshotClaimed.empty() && snapshotClaimed[row]) return Snapshot::NOT_FOUND;
+    return row;
+}
+
+void Bank::claimSnapshotRow(std::size_t row) {
+    if (snapshotClaimed.empty()) snapshotClaimed.assign(snapshot.size(), 0);
+    snapshotClaimed[row] = 1;
+    --snapshotPending;
+}
+
+std::uint32_t Bank::loadFromSnapshot(int id) {
+    std::size_t row = pendingSnapshotRow(id);
+    if (row == Snapshot::NOT_FOUND) return UINT32_MAX;
+    claimSnapshotRow(row);
+    AccountRow fields = snapshot.row(row);
+    return insertAccount(Account(fields.id, fields.balance, fields.name));
+}
+
+void Bank::loadSnapshot() {
+    if (!snapshot.isOpen()) return;
+    std::vector<AccountRow> rows;
+    rows.reserve(snapshotPending);
+    for (std::size_t row = 0; row < snapshot.size(); ++row) {
+        if (snapshotClaimed.empty() || !snapshotClaimed[row]) rows.push_back(snapshot.row(row));
+    }
+    insertRows(rows, nullptr, false);
+    // Names are interned while loading, so nothing points into the mapping any more.
+    snapshot.close();
+    snapshotClaimed.clear();
+    snapshotClaimed.shrink_to_fit();
+    snapshotPending = 0;
+}
+
+bool Bank::addAccount(const Account &account, std::uint64_t *deferred) {
+    std::uint64_t sequence;
+    {
+        std::unique_lock<std::shared_mutex> table(tableMutex);
+        if (!addAccountLocked(account, sequence)) return false;
+    }
+    if (deferred != nullptr) {
+        *deferred = sequence;
+        return true;
+    }
+    return logWait(sequence);
+}
+
+bool Bank::addAccountLocked(const Account &account, std::uint64_t &sequence) {
+    if(slotById.count(account.getId()) != 0) return false;
+    if(pendingSnapshotRow(account.getId()) != Snapshot::NOT_FOUND) return false;
+    if (!logChange({{LogOp::Add, account.getId(), account.getBalance(), account.getName()}}, sequence)) return false;
+    compactLocked(ADD_COMPACTION_SLICE);
+    markDirty(insertAccount(account));
+    return true;
+}
+
+std::uint32_t Bank::insertAccount(const Account &account) {
+    std::uint32_t slot = store.create(account).slot;
+    slotById.emplace(account.getId(), slot);
+    columns.assign(slot, account);
+    nameIndex.add(slot, account.getName());
+    balanceIndex.add(slot, account.getBalance());
+    views.add(slot, account.getId(), account.getName());
+    if (slot >= balanceNoted.size()) balanceNoted.resize(slot + 1, 0);
+    return slot;
+}
+
+std::size_t Bank::bulkLoad(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return 0;
+    std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(&text[0], text.size())) return 0;
+
+    std::size_t rejected;
+    std::vector<AccountRow> rows = AccountCsv::parse(text, 0, rejected);
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    loadSnapshot(); // The duplicate check below needs every id in the id index.
+    std::vector<int> logged;
+    std::size_t added = insertRows(rows, logging ? &logged : nullptr, true);
+    // One group commit for the whole file. It is waited for under the lock, so no other
+    // mutation builds on the new accounts before they are known to be durable.
+    if (logging && !log.flush()) {
+        // The file's records come last in the log; take out the ones it lost, newest
+        // first, then undo whatever else it lost.
+        std::uint64_t sequence = log.lastSequence();
+        std::uint64_t durable = log.lastDurable();
+        for (auto id = logged.rbegin(); id != logged.rend() && sequence > durable; ++id, --sequence) {
+            dropAccount(slotById.at(*id));
+            --added;
+        }
+        rollBackLostChanges();
+    }
+    return added;
+}
+
+std::size_t Bank::insertRows(const std::vector<AccountRow> &rows, std::vector<int> *logged, bool changed) {
+    compactLocked(tombstones.size()); // Start from clean indexes.
+    NamePool::instance().reserve(rows.size());
+    slotById.reserve(slotById.size() + rows.size());
+    store.reserve(rows.size());
+    columns.reserve(store.slotCount() + rows.size());
+    balanceNoted.resize(store.slotCount() + rows.size(), 0);
+
+    std::vector<std::pair<Money, std::uint32_t>> balanceBatch;
+    std::vector<std::pair<std::string_view, std::uint32_t>> nameBatch;
+    std::vector<std::pair<int, std::uint32_t>> idBatch;
+    balanceBatch.reserve(rows.size());
+    nameBatch.reserve(rows.size());
+    idBatch.reserve(rows.size());
+
+    std::size_t added = 0;
+    for (const AccountRow &row : rows) {
+        // The id index doubles as the duplicate check, against both the bank and the file.
+        auto [it, inserted] = slotById.emplace(row.id, 0);
+        if (!inserted) continue;
+        Account account(row.id, row.balance, row.name);
+        if (logged != nullptr) {
+            if (log.append({LogOp::Add, account.getId(), account.getBalance(), account.getName()}) == 0) {
+                slotById.erase(it);
+                break; // The log failed; nothing after this can be made durable.
+            }
+            logged->push_back(account.getId());
+        }
+        std::uint32_t slot = store.create(account).slot;
+        it->second = slot;
+        columns.assign(slot, account);
+        balanceBatch.emplace_back(account.getBalance(), slot);
+        nameBatch.emplace_back(account.getName(), slot);
+        idBatch.emplace_back(account.getId(), slot);
+        if (changed) markDirty(slot);
+        ++added;
+    }
+    // The indexes are independent of each other, so build them side by side.
+    std::thread balanceBuilder([&] { balanceIndex.addBatch(std::move(balanceBatch)); });
+    std::thread viewBuilder([&] { views.addBatch(nameBatch, std::move(idBatch)); });
+    nameIndex.addBatch(nameBatch);
+    balanceBuilder.join();
+    viewBuilder.join();
+    return added;
+}
+
+void Bank::displayAccounts(std::ostream &out) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    switch (displayOrder) {
+        case SortOrder::Name:
+            displaySlotsFormatted(table, views.slotsByName(), out);
+            break;
+        case SortOrder::Balance:
+            displaySlotsFormatted(table, balanceIndex.slots(), out);
+            break;
+        case SortOrder::Id:
+            displaySlotsFormatted(table, views.slotsById(), out);
+            break;
+        default: {
+            std::vector<std::uint32_t> all(store.slotCount());
+            for (std::uint32_t slot = 0; slot < all.size(); ++slot) all[slot] = slot;
+            displaySlotsFormatted(table, all, out);
+        }
+    }
+}
+
+void Bank::displayAccountsFormatted(const AccountColumns::View &accounts, const std::vector<std::uint32_t> &slots, std::ostream &out) {
+    out << "\033[H\033[2J"; // Clear the screen with an escape sequence, which also works for remote sessions.
     // Display the header
     // ... (header formatting code) ...
-    std::cout << "\033[34m" << std::setfill('*') << std::setw(COL_WIDTH *3) << '*' << "\033[0m" << std::endl 
-        << std::left << std::setfill(' ') << std::setw(COL_WIDTH) << "Account#" << std::setw(COL_WIDTH) 
-        << "Name" << std::setw(COL_WIDTH) << std::right << "Balance" << std::endl 
+    out << "\033[34m" << std::setfill('*') << std::setw(COL_WIDTH *3) << '*' << "\033[0m" << std::endl
+        << std::left << std::setfill(' ') << std::setw(COL_WIDTH) << "Account#" << std::setw(COL_WIDTH)
+        << "Name" << std::setw(COL_WIDTH) << std::right << "Balance" << std::endl
         << "\033[34m" << std::setfill(FILLER) << std::setw(COL_WIDTH *3) << FILLER << "\033[0m" << std::endl;
     // Iterate over the accounts and display each one.
-    for (const auto &acc : accounts) {
+    for (std::uint32_t slot : slots) {
+        if (slot >= accounts.size() || !accounts.isLive(slot)) continue;
         // ... (account display code) ...
-        std::cout << std::fixed << std::setprecision(2) << std::left << std::setfill(' ') << std::setw(COL_WIDTH) << acc.getId() << std::setw(COL_WIDTH) 
-        << acc.getName() << std::setw(COL_WIDTH) << std::right << acc.getBalance() << std::endl << "\033[34m" << std::setfill(FILLER) << std::setw(COL_WIDTH *3) << FILLER << "\033[0m" << std::endl;        
+        out << std::fixed << std::setprecision(2) << std::left << std::setfill(' ') << std::setw(COL_WIDTH) << accounts.id(slot) << std::setw(COL_WIDTH)
+        << accounts.name(slot) << std::setw(COL_WIDTH) << std::right << accounts.balance(slot) << std::endl << "\033[34m" << std::setfill(FILLER) << std::setw(COL_WIDTH *3) << FILLER << "\033[0m" << std::endl;
     }
-    std::cout << std::endl; // End of the account list.
+    out << std::endl; // End of the account list.
+}
+
+AccountColumns::View Bank::view() {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    return columns.view();
+}
+
+const Account* Bank::findAccount(int id) {
+    AccountHandle handle = findHandle(id);
+    if (handle.isNull()) return nullptr;
+    return getAccount(handle);
+}
+
+AccountHandle Bank::findHandle(int id) {
+    {
+        std::shared_lock<std::shared_mutex> table(tableMutex);
+        auto it = slotById.find(id);
+        if (it != slotById.end()) return store.handleAt(it->second);
+        if (snapshotPending == 0) return AccountHandle();
+    }
+    // Loading from the snapshot changes the table; check again under the exclusive lock.
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    auto it = slotById.find(id);
+    if (it != slotById.end()) return store.handleAt(it->second);
+    std::uint32_t slot = loadFromSnapshot(id);
+    if (slot == UINT32_MAX) return AccountHandle();
+    return store.handleAt(slot);
+}
+
+const Account* Bank::getAccount(AccountHandle handle) const {
+    std::shared_lock<std::shared_mutex> table(tableMutex);
+    return store.get(handle);
+}
+
+bool Bank::checkBalance(AccountHandle handle, Money &balance) const {
+    // Balance updates store one atomic word, so a lone read needs neither the table
+    // lock nor a stripe lock; the store validates it against concurrent deletes.
+    return store.readBalance(handle, balance);
 }
 
-Account* Bank::findAccount(int id) {
-    for (auto &acc : accounts) {
-        if (acc.getId() == id) {
-            return &acc;
+bool Bank::deposit(int id, Money amount) {
+    return deposit(findHandle(id), amount);
+}
+
+bool Bank::deposit(AccountHandle handle, Money amount, std::uint64_t *sequence) {
+    return changeBalance(handle, LogOp::Deposit, amount, sequence);
+}
+
+bool Bank::withdraw(int id, Money amount) {
+    return withdraw(findHandle(id), amount);
+}
+
+bool Bank::withdraw(AccountHandle handle, Money amount, std::uint64_t *sequence) {
+    return changeBalance(handle, LogOp::Withdraw, amount, sequence);
+}
+
+bool Bank::changeBalance(AccountHandle handle, LogOp op, Money amount, std::uint64_t *deferred) {
+    std::uint64_t sequence;
+    {
+        std::shared_lock<std::shared_mutex> table(tableMutex);
+        Account *acc = store.get(handle);
+        if (acc == nullptr) return false;
+        bool changed;
+        if (lockFree()) {
+            noteBalanceChange(handle.slot, *acc);
+            changed = op == LogOp::Deposit ? acc->depositAtomic(amount) : acc->withdrawAtomic(amount);
+            if (!changed) return false;
+            sequence = 0; // No log is open.
+        } else {
+            std::lock_guard<std::mutex> lock(stripeFor(handle.slot).mutex);
+            // Check, then log, then change, so a change the log refuses is never made.
+            // Logged under the stripe lock, so the log orders each account's updates as applied.
+            Money updated;
+            if (amount < Money()) return false;
+            if (op == LogOp::Deposit ? !acc->getBalance().checkedAdd(amount, updated) : amount > acc->getBalance()) return false;
+            if (!logChange({{op, acc->getId(), amount, {}}}, sequence)) return false;
+            noteBalanceChange(handle.slot, *acc);
+            if (op == LogOp::Deposit) acc->deposit(amount);
+            else acc->withdraw(amount);
         }
     }
-    return nullptr;
+    if (deferred != nullptr) {
+        *deferred = sequence;
+        return true;
+    }
+    return logWait(sequence);
 }
 
-bool Bank::deleteAccount(int id) {
-    if(!findAccount(id)) return false;
-    accounts.erase(std::remove_if(accounts.begin(), accounts.end(),
-                                    [id](const Account& acc) { return acc.getId() == id; }),
-                    accounts.end());
-    return true;
+bool Bank::transfer(int fromId, int toId, Money amount) {
+    return transfer(findHandle(fromId), findHandle(toId), amount);
+}
+
+bool Bank::transfer(AccountHandle from, AccountHandle to, Money amount) {
+    std::uint64_t sequence;
+    {
+        // Lock-free updates take no stripe lock; only the exclusive table lock keeps them out.
+        std::shared_lock<std::shared_mutex> shared(tableMutex, std::defer_lock);
+        std::unique_lock<std::shared_mutex> exclusive(tableMutex, std::defer_lock);
+        if (lockFree()) exclusive.lock();
+        else shared.lock();
+        Account *source = store.get(from);
+        Account *target = store.get(to);
+        if (source == nullptr || target == nullptr || source == target) return false;
+        std::unique_lock<std::mutex> first, second;
+        if (!lockFree()) lockStripes(from.slot, to.slot, first, second);
+        if (!canMoveBalance(*source, *target, amount)) return false;
+        if (!logChange({{LogOp::Transfer, source->getId(), amount, {}, target->getId()}}, sequence)) return false;
+        moveBalance(from.slot, *source, to.slot, *target, amount);
+    }
+    return logWait(sequence);
 }
 
-void Bank::displayAccountsByName(const std::string& name) {    
-    std::vector<Account> filteredAccounts;
-    for (const auto &acc : accounts) {
-        if (acc.getName().find(name) != std::string::npos) {
-            filteredAccounts.push_back(acc);
+std::size_t Bank::transfer(const std::vector<Transfer> &batch, std::vector<bool> &succeeded) {
+    succeeded.assign(batch.size(), false);
+    // Resolve every id under one shared lock; only ids still in the snapshot need findHandle().
+    std::vector<std::pair<AccountHandle, AccountHandle>> handles(batch.size());
+    bool missed = false;
+    {
+        std::shared_lock<std::shared_mutex> table(tableMutex);
+        auto lookup = [&](int id, AccountHandle &handle) {
+            auto it = slotById.find(id);
+            if (it != slotById.end()) handle = store.handleAt(it->second);
+            else missed |= snapshotPending != 0;
+        };
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            lookup(batch[i].from, handles[i].first);
+            lookup(batch[i].to, handles[i].second);
         }
     }
-    displayAccountsFormatted(filteredAccounts);
+    for (std::size_t i = 0; missed && i < batch.size(); ++i) {
+        if (handles[i].first.isNull()) handles[i].first = findHandle(batch[i].from);
+        if (handles[i].second.isNull()) handles[i].second = findHandle(batch[i].to);
+    }
+    // Sort by the pair of stripes each transfer locks, then by batch position.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> order;
+    order.reserve(batch.size());
+    for (std::uint32_t i = 0; i < batch.size(); ++i) {
+        if (handles[i].first.isNull() || handles[i].second.isNull()) continue;
+        std::size_t a = stripeIndex(handles[i].first.slot), b = stripeIndex(handles[i].second.slot);
+        order.emplace_back(static_cast<std::uint32_t>(std::min(a, b) * BALANCE_STRIPES + std::max(a, b)), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::size_t done = 0;
+    std::uint64_t sequence = 0;
+    std::vector<std::uint64_t> sequences(logging ? batch.size() : 0);
+    {
+        std::shared_lock<std::shared_mutex> shared(tableMutex, std::defer_lock);
+        std::unique_lock<std::shared_mutex> exclusive(tableMutex, std::defer_lock);
+        if (lockFree()) exclusive.lock();
+        else shared.lock();
+        std::unique_lock<std::mutex> first, second;
+        std::uint32_t held = UINT32_MAX;
+        for (const auto &[stripePair, i] : order) {
+            Account *source = store.get(handles[i].first);
+            Account *target = store.get(handles[i].second);
+            if (source == nullptr || target == nullptr || source == target) continue;
+            if (!lockFree() && stripePair != held) {
+                if (second.owns_lock()) second.unlock();
+                if (first.owns_lock()) first.unlock();
+                lockStripes(handles[i].first.slot, handles[i].second.slot, first, second);
+                held = stripePair;
+            }
+            if (!canMoveBalance(*source, *target, batch[i].amount)) continue;
+            std::uint64_t logged;
+            if (!logChange({{LogOp::Transfer, source->getId(), batch[i].amount, {}, target->getId()}}, logged)) continue;
+            moveBalance(handles[i].first.slot, *source, handles[i].second.slot, *target, batch[i].amount);
+            if (logging) sequences[i] = logged;
+            sequence = std::max(sequence, logged);
+            succeeded[i] = true;
+            ++done;
+        }
+    }
+    if (done != 0 && !logWait(sequence)) {
+        // The transfers the log lost are undone; only those on disk before it failed stand.
+        std::uint64_t durable = log.lastDurable();
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (succeeded[i] && sequences[i] > durable) {
+                succeeded[i] = false;
+                --done;
+            }
+        }
+    }
+    return done;
 }
 
-void Bank::displayAccountsByBalance(const double& minBalance) {
-    std::vector<Account> filteredAccounts;
-    for (const auto &acc : accounts) {
-        if (acc.getBalance() > minBalance) {
-            filteredAccounts.push_back(acc);
+std::size_t Bank::applyBatch(const std::vector<BalanceUpdate> &batch, std::vector<UpdateResult> &results) {
+    results.assign(batch.size(), UpdateResult::NotFound);
+    // Look the ids up in ascending order. The id index hashes an int to its own value,
+    // so its buckets, and the accounts of a bank loaded in id order, are visited front
+    // to back instead of at random. Equal ids keep their batch order.
+    std::vector<std::pair<int, std::uint32_t>> byId(batch.size());
+    for (std::uint32_t i = 0; i < batch.size(); ++i) byId[i] = {batch[i].id, i};
+    ParallelSort::sort(byId);
+
+    std::size_t applied = 0;
+    std::uint64_t sequence = 0;
+    std::vector<std::uint64_t> sequences(logging ? batch.size() : 0);
+    bool loaded = false;
+    while (true) {
+        // Lock-free updates take no stripe lock; only the exclusive table lock keeps them out.
+        std::shared_lock<std::shared_mutex> shared(tableMutex, std::defer_lock);
+        std::unique_lock<std::shared_mutex> exclusive(tableMutex, std::defer_lock);
+        if (lockFree()) exclusive.lock();
+        else shared.lock();
+        // (slot, batch position) of every update whose account exists; the slots stay
+        // live while the table lock is held.
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> bySlot;
+        bySlot.reserve(batch.size());
+        bool missed = false;
+        std::uint32_t slot = 0;
+        for (std::size_t k = 0; k < byId.size(); ++k) {
+            auto [id, i] = byId[k];
+            if (k == 0 || id != byId[k - 1].first) {
+                auto it = slotById.find(id);
+                slot = it != slotById.end() ? it->second : UINT32_MAX;
+                missed |= slot == UINT32_MAX && snapshotPending != 0;
+            }
+            if (slot != UINT32_MAX) bySlot.emplace_back(slot, i);
+        }
+        if (missed && !loaded) {
+            // Load the accounts still in the snapshot, which needs the lock exclusively, then start over.
+            if (shared.owns_lock()) shared.unlock();
+            if (exclusive.owns_lock()) exclusive.unlock();
+            for (const BalanceUpdate &update : batch) findHandle(update.id);
+            loaded = true;
+            continue;
+        }
+        // In a bank loaded in id order the slots already ascend; otherwise sort by slot,
+        // then batch position, so each account's updates keep their order.
+        if (!std::is_sorted(bySlot.begin(), bySlot.end())) ParallelSort::sort(bySlot);
+
+        std::unique_lock<std::mutex> stripe;
+        std::size_t held = BALANCE_STRIPES;
+        for (std::size_t k = 0; k < bySlot.size(); ++k) {
+            if (k + PREFETCH_DISTANCE < bySlot.size()) {
+                auto [ahead, position] = bySlot[k + PREFETCH_DISTANCE];
+                store.prefetch(ahead);
+                __builtin_prefetch(&balanceNoted[ahead], 1);
+                __builtin_prefetch(&batch[position], 0);
+                __builtin_prefetch(&results[position], 1);
+            }
+            auto [target, i] = bySlot[k];
+            const BalanceUpdate &update = batch[i];
+            Account &acc = store.at(target);
+            if (update.amount < Money()) {
+                results[i] = UpdateResult::InvalidAmount;
+                continue;
+            }
+            // Release one stripe before taking the next, so no two are ever held out of order.
+            if (!lockFree() && stripeIndex(target) != held) {
+                if (stripe.owns_lock()) stripe.unlock();
+                stripe = std::unique_lock<std::mutex>(stripeFor(target).mutex);
+                held = stripeIndex(target);
+            }
+            bool withdrawal = update.op == BalanceUpdate::Op::Withdraw;
+            Money credited;
+            if (withdrawal && update.amount > acc.getBalance()) {
+                results[i] = UpdateResult::InsufficientFunds;
+                continue;
+            }
+            if (!withdrawal && !acc.getBalance().checkedAdd(update.amount, credited)) {
+                results[i] = UpdateResult::Overflow;
+                continue;
+            }
+            std::uint64_t logged;
+            if (!logChange({{withdrawal ? LogOp::Withdraw : LogOp::Deposit, acc.getId(), update.amount, {}}}, logged)) {
+                results[i] = UpdateResult::NotLogged;
+                continue;
+            }
+            noteBalanceChange(target, acc);
+            if (withdrawal) acc.withdraw(update.amount);
+            else acc.deposit(update.amount);
+            if (logging) sequences[i] = logged;
+            sequence = std::max(sequence, logged);
+            results[i] = UpdateResult::Applied;
+            ++applied;
+        }
+        break;
+    }
+    if (applied != 0 && !logWait(sequence)) {
+        // The updates the log lost are undone; only those on disk before it failed stand.
+        std::uint64_t durable = log.lastDurable();
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (results[i] == UpdateResult::Applied && sequences[i] > durable) {
+                results[i] = UpdateResult::NotLogged;
+                --applied;
+            }
         }
     }
-    displayAccountsFormatted(filteredAccounts);
+    return applied;
+}
+
+bool Bank::canMoveBalance(const Account &from, const Account &to, Money amount) {
+    Money credited;
+    if (amount < Money() || amount > from.getBalance()) return false;
+    return to.getBalance().checkedAdd(amount, credited);
+}
+
+bool Bank::moveBalance(std::uint32_t fromSlot, Account &from, std::uint32_t toSlot, Account &to, Money amount) {
+    if (!canMoveBalance(from, to, amount)) return false;
+    noteBalanceChange(fromSlot, from);
+    noteBalanceChange(toSlot, to);
+    from.withdraw(amount);
+    to.deposit(amount);
+    return true;
+}
+
+bool Bank::totalBalance(Money &total) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    AccountColumns::View accounts = columns.view();
+    table.unlock();
+    return accounts.totalBalance(total);
+}
+
+std::size_t Bank::countAccountsByBalance(Money minBalance) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    AccountColumns::View accounts = columns.view();
+    table.unlock();
+    return accounts.countBalanceAbove(minBalance);
+}
+
+bool Bank::deleteAccount(int id, std::uint64_t *deferred) {
+    std::uint64_t sequence;
+    {
+        std::unique_lock<std::shared_mutex> table(tableMutex);
+        if (!deleteAccountLocked(id, sequence)) return false;
+    }
+    if (deferred != nullptr) {
+        *deferred = sequence;
+        return true;
+    }
+    return logWait(sequence);
+}
+
+bool Bank::deleteAccountLocked(int id, std::uint64_t &sequence) {
+    auto it = slotById.find(id);
+    if (it == slotById.end()) {
+        // An account still in the snapshot is deleted by never loading it.
+        std::size_t row = pendingSnapshotRow(id);
+        if (row == Snapshot::NOT_FOUND) return false;
+        AccountRow fields = snapshot.row(row);
+        // Interned, as the snapshot may be closed before the deletion could be undone.
+        std::string_view name = logging ? NamePool::instance().intern(fields.name) : std::string_view();
+        if (!logChange({{LogOp::Delete, id, Money(), {}}, fields.balance, name}, sequence)) return false;
+        claimSnapshotRow(row);
+        deletedIds.push_back(id);
+        return true;
+    }
+    const Account &acc = store.at(it->second);
+    if (!logChange({{LogOp::Delete, id, Money(), {}}, acc.getBalance(), acc.getName()}, sequence)) return false;
+    dropAccount(it->second);
+    deletedIds.push_back(id);
+    return true;
+}
+
+void Bank::dropAccount(std::uint32_t slot) {
+    slotById.erase(store.at(slot).getId());
+    // Every scan checks the live column and every index result is checked against
+    // the store, so the tombstone is invisible from here on.
+    columns.erase(slot);
+    store.retire(store.handleAt(slot));
+    tombstones.push_back(slot);
+}
+
+std::size_t Bank::compact(std::size_t maxSlots) {
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    return compactLocked(maxSlots);
+}
+
+std::size_t Bank::compactLocked(std::size_t maxSlots) {
+    if (tombstones.empty()) return 0;
+    applyBalanceChanges(); // The balance index must hold each tombstone's final balance.
+    for (std::size_t done = 0; done < maxSlots && !tombstones.empty(); ++done) {
+        std::uint32_t slot = tombstones.back();
+        tombstones.pop_back();
+        const Account &acc = store.at(slot);
+        nameIndex.remove(slot, acc.getName());
+        balanceIndex.remove(slot, acc.getBalance());
+        views.remove(slot, acc.getId(), acc.getName());
+        store.release(slot);
+    }
+    return tombstones.size();
+}
+
+void Bank::displaySlotsFormatted(std::unique_lock<std::shared_mutex> &table, const std::vector<std::uint32_t> &slots, std::ostream &out) {
+    // Printing can take a while; the view keeps the listing consistent without the lock.
+    AccountColumns::View accounts = columns.view();
+    table.unlock();
+    displayAccountsFormatted(accounts, slots, out);
+}
+
+std::vector<int> Bank::liveIds(const std::vector<std::uint32_t> &slots) const {
+    std::vector<int> ids;
+    ids.reserve(slots.size());
+    for (std::uint32_t slot : slots) {
+        if (store.isLive(slot)) ids.push_back(store.at(slot).getId());
+    }
+    return ids;
+}
+
+void Bank::displayAccountsByName(const std::string& name, std::ostream &out) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    if (!NameIndex::canSearch(name)) {
+        displaySlotsFormatted(table, columns.slotsWithNameContaining(name), out);
+        return;
+    }
+    // Matches come back in slot order, the same order as a full scan.
+    displaySlotsFormatted(table, nameIndex.matches(name), out);
+}
+
+void Bank::displayAccountsByBalance(const Money& minBalance, std::ostream &out) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    displaySlotsFormatted(table, balanceIndex.slotsAbove(minBalance), out);
+}
+
+void Bank::displayAccountsByBalance(const Money& low, const Money& high, std::ostream &out) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    displaySlotsFormatted(table, balanceIndex.slotsInRange(low, high), out);
+}
+
+std::vector<int> Bank::findAccountsByBalance(Money minBalance) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    return liveIds(balanceIndex.slotsAbove(minBalance));
+}
+
+std::vector<int> Bank::findAccountsByBalance(Money low, Money high) {
+    std::unique_lock<std::shared_mutex> table = lockForReport();
+    return liveIds(balanceIndex.slotsInRange(low, high));
 }
 
 void Bank::sortAccountsByName(){
-    std::sort(accounts.begin(), accounts.end(),
-            [](const Account& a, const Account& b) { return a.getName() < b.getName(); });
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    displayOrder = SortOrder::Name;
 }
 
 void Bank::sortAccountsByBalance(){
-    std::sort(accounts.begin(), accounts.end(),
-            [](const Account& a, const Account& b) { return a.getBalance() < b.getBalance(); });
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    displayOrder = SortOrder::Balance;
 }
 
 void Bank::sortAccountsById(){
-    std::sort(accounts.begin(), accounts.end(),
-            [](const Account& a, const Account& b) { return a.getId() < b.getId(); });
+    std::unique_lock<std::shared_mutex> table(tableMutex);
+    displayOrder = SortOrder::Id;
 }
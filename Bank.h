@@ -2,67 +2,682 @@
 #define BANK_H
 
 #include <vector>
+#include <string>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <array>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "Money.h"
 #include "Account.h"
+#include "AccountStore.h"
+#include "AccountColumns.h"
+#include "NameIndex.h"
+#include "BalanceIndex.h"
+#include "SortedViews.h"
+#include "AccountCsv.h"
+#include "Snapshot.h"
+#include "WriteAheadLog.h"
+#include "SnapshotMerger.h"
+
+// One transfer of a batch given to Bank::transfer().
+struct Transfer {
+    int from;       // Id of the paying account
+    int to;         // Id of the receiving account
+    Money amount;   // Amount to move
+};
+
+// One deposit or withdrawal of a batch given to Bank::applyBatch().
+struct BalanceUpdate {
+    enum class Op : std::uint8_t { Deposit, Withdraw };
+
+    int id;         // Id of the account
+    Op op;          // Whether to deposit or withdraw
+    Money amount;   // Amount to deposit or withdraw
+};
+
+// The outcome of one update of a batch given to Bank::applyBatch().
+enum class UpdateResult : std::uint8_t {
+    Applied,            // The balance changed
+    NotFound,           // No account has the id
+    InvalidAmount,      // The amount is negative
+    InsufficientFunds,  // A withdrawal exceeds the balance
+    Overflow,           // A deposit would overflow the balance
+    NotLogged           // The write-ahead log failed to record the update, so it was not made
+};
 
 // The Bank class represents a bank with functionalities to manage accounts.
+//
+// Every public member function is safe to call from several threads at once. The
+// account table (the store, the id index and every derived index) is guarded by a
+// reader-writer lock: adding and deleting accounts take it exclusively, while
+// balance updates share it and then lock only the stripe their account maps to,
+// so deposits and withdrawals on different accounts run in parallel. Balance
+// updates leave the balance column and index to be brought up to date by the next
+// report, which takes the table lock exclusively for a moment, then prints from a
+// point-in-time view after releasing it.
+//
+// The ConcurrencyMode chosen at construction decides how balance updates are
+// serialized: one mutex for every account, one lock per stripe of accounts, or no
+// lock at all, with compare-and-swap updates on the account itself. Lock-free mode
+// makes transfers take the table lock exclusively, as no stripe lock keeps the
+// single-account updates out.
+//
+// Whatever the mode, checkBalance() on a handle takes no lock: it reads the balance
+// word directly and validates it against the slot's generation, so balance reads
+// never wait for writers nor slow them down.
 class Bank {
 public:
+    // How concurrent balance updates are serialized.
+    enum class ConcurrencyMode {
+        Mutex,      // One lock for every balance
+        Striped,    // One lock per stripe of accounts
+        LockFree    // Atomic updates; falls back to Striped while a log is open
+    };
+
+    /**
+     * Constructor to create an empty Bank
+     * @param mode How concurrent balance updates are serialized
+    */
+    explicit Bank(ConcurrencyMode mode = ConcurrencyMode::Striped);
+
+    /**
+     * Loads accounts from a CSV file with one "id,name,balance" line per account.
+     * Lines are parsed in parallel, storage is reserved up front, duplicate ids are
+     * caught by a single pass over the id index, and the ordered indexes are built
+     * once from the whole batch. Malformed lines and ids already present are skipped.
+     * @param path The path of the CSV file.
+     * @return The number of accounts added, or 0 if the file could not be read.
+    */
+    std::size_t bulkLoad(const std::string &path);
+
+    /**
+     * Opens a binary snapshot written by saveSnapshot() as the bank's accounts. The
+     * file is mapped, not read: an account is loaded the first time it is looked up,
+     * deposited to, withdrawn from or deleted, and operations that need every account
+     * (displays, searches, totals) load the rest in one batch first. Opening takes the
+     * same few system calls whatever the number of accounts. Delta snapshots written
+     * by checkpoint() since the snapshot was saved are applied on top, and later
+     * checkpoints to the same path write deltas too.
+     * @param path The path of the snapshot file.
+     * @return true if the snapshot was opened, false if the file or one of its deltas
+     * is not a valid snapshot, or the bank already holds accounts.
+    */
+    bool openSnapshot(const std::string &path);
+
+    /**
+     * Writes every account to a binary snapshot, in ascending id order. The file is
+     * replaced atomically, so the snapshot the bank was opened from can be overwritten.
+     * @param path The path of the snapshot file.
+     * @return true if the snapshot was written, false otherwise.
+    */
+    bool saveSnapshot(const std::string &path);
+
+    /**
+     * Makes every later mutation durable through a write-ahead log. The records
+     * already in the log are replayed first, except those the opened snapshot
+     * already reflects, so recovery is openSnapshot() followed by openLog().
+     * From then on addAccount, deleteAccount, deposit, withdraw and bulkLoad only
+     * return once their records are on disk; concurrent callers share fsyncs. Each
+     * mutation is logged before it is made, and if the log fails before its record
+     * is on disk, the mutation and every later one the log lost are undone and
+     * reported as failed, so the bank always matches what recovery would rebuild.
+     * An event loop that must not block passes those calls a sequence pointer
+     * instead, and finishes each mutation once whenDurable() says its record is settled.
+     * @param path The path of the log file, created if it does not exist.
+     * @return true if the log was opened, false otherwise.
+    */
+    bool openLog(const std::string &path);
+
+    /**
+     * Calls a function once the record of a mutation made without waiting for the
+     * log is on disk or known to be lost, without blocking the caller.
+     * @param sequence A sequence number received from a mutation.
+     * @param ready Called once, from the log's flusher thread, or right away if the
+     * outcome is already known. It must not block or call into the bank.
+    */
+    void whenDurable(std::uint64_t sequence, std::function<void()> ready);
+
+    /**
+     * Finishes a mutation made without waiting for the log. Blocks only if
+     * whenDurable() has not called back yet.
+     * @param sequence A sequence number received from a mutation.
+     * @return true if the mutation is durable, false if the log lost it and it was
+     * undone, with every later mutation the log lost.
+    */
+    bool finishMutation(std::uint64_t sequence);
+
+    /**
+     * Saves a snapshot that reflects every logged mutation, then empties the log,
+     * so that recovery only replays what happened after the checkpoint. When a log
+     * is open and the bank was opened from or last checkpointed to the same path,
+     * only the accounts changed since the previous checkpoint are written, as a
+     * delta next to the snapshot; once deltas pile up they are merged into the
+     * snapshot on a background thread. Otherwise the whole bank is written.
+     * @param snapshotPath The path of the snapshot file.
+     * @return true if the snapshot was written and the log emptied, false otherwise.
+    */
+    bool checkpoint(const std::string &snapshotPath);
+
     /**
      * Adds a new account to the bank.
      * @param account A constant reference to an Account object to be added.
+     * @param sequence If not null, the call returns as soon as the mutation is made,
+     * without waiting for the log, and this receives the sequence number to pass to
+     * whenDurable() and finishMutation(), or 0 if no log is open.
      * @return A boolean indicating if the account was successfully added.
     */
-    bool addAccount(const Account &account);
+    bool addAccount(const Account &account, std::uint64_t *sequence = nullptr);
 
-    // Displays all accounts in the bank.
-    void displayAccounts();
+    // Displays all accounts in the bank, in the order chosen by the last sortAccountsBy* call, on out.
+    void displayAccounts(std::ostream &out = std::cout);
+
+    /**
+     * Takes a consistent point-in-time view of every account's id, name and balance
+     * in O(1). The view can be read for as long as needed, on any thread, while
+     * deposits and withdrawals keep committing; it never sees them. Storage shared
+     * with later versions is copied on write and freed with the last view using it.
+     * @return The view, indexed by slot.
+    */
+    AccountColumns::View view();
 
     /**
-     * Finds an account by its ID
+     * Finds an account by its ID in O(1) expected time through the id index.
      * @param id An integer representing the account's unique ID.
-     * @returns A pointer to the Account object, or nullptr if not found
+     * @returns A pointer to the Account object, or nullptr if not found.
+     * Accounts never move, so the pointer stays valid until the account is deleted.
+     * Balances are changed through deposit() and withdraw() so the bank's indexes stay in sync.
     */
-    Account* findAccount(int id);
+    const Account* findAccount(int id);
 
     /**
-     * Displays accounts filtered by name
+     * Finds a handle to an account by its ID.
+     * @param id An integer representing the account's unique ID.
+     * @return A handle to the account, or a null handle if not found.
+    */
+    AccountHandle findHandle(int id);
+
+    /**
+     * Dereferences an account handle in O(1).
+     * @param handle A handle returned by findHandle().
+     * @return A pointer to the Account object, or nullptr if the account was deleted.
+     * Use checkBalance() to read the balance while other threads may update it.
+    */
+    const Account* getAccount(AccountHandle handle) const;
+
+    /**
+     * Reads the balance of the account a handle refers to, without taking any lock.
+     * A read that races with the account's deletion reports the account as gone.
+     * @param handle A handle returned by findHandle().
+     * @param balance Receives the balance.
+     * @return true if the account still exists, false otherwise.
+    */
+    bool checkBalance(AccountHandle handle, Money &balance) const;
+
+    /**
+     * Deposits an amount into an account.
+     * @param id An integer representing the account's unique ID.
+     * @param amount A Money amount representing the amount to be deposited.
+     * @return true if the account exists and the deposit succeeded, false otherwise.
+    */
+    bool deposit(int id, Money amount);
+
+    /**
+     * Deposits an amount into the account a handle refers to, without an id lookup.
+     * @param handle A handle returned by findHandle().
+     * @param amount A Money amount representing the amount to be deposited.
+     * @param sequence If not null, the call returns as soon as the mutation is made,
+     * without waiting for the log, and this receives the sequence number to pass to
+     * whenDurable() and finishMutation(), or 0 if no log is open.
+     * @return true if the account still exists and the deposit succeeded, false otherwise.
+    */
+    bool deposit(AccountHandle handle, Money amount, std::uint64_t *sequence = nullptr);
+
+    /**
+     * Withdraws an amount from an account.
+     * @param id An integer representing the account's unique ID.
+     * @param amount A Money amount representing the amount to be withdrawn.
+     * @return true if the account exists and has sufficient funds, false otherwise.
+    */
+    bool withdraw(int id, Money amount);
+
+    /**
+     * Withdraws an amount from the account a handle refers to, without an id lookup.
+     * @param handle A handle returned by findHandle().
+     * @param amount A Money amount representing the amount to be withdrawn.
+     * @param sequence If not null, the call returns as soon as the mutation is made,
+     * without waiting for the log, and this receives the sequence number to pass to
+     * whenDurable() and finishMutation(), or 0 if no log is open.
+     * @return true if the account still exists and has sufficient funds, false otherwise.
+    */
+    bool withdraw(AccountHandle handle, Money amount, std::uint64_t *sequence = nullptr);
+
+    /**
+     * Moves an amount from one account to another as one atomic step: no other thread
+     * ever sees the money in neither or in both accounts, and the write-ahead log
+     * records it as a single record. The two balance locks are always taken in stripe
+     * order, so concurrent transfers in opposite directions cannot deadlock.
+     * @param fromId The id of the paying account.
+     * @param toId The id of the receiving account.
+     * @param amount A Money amount representing the amount to move.
+     * @return true if both accounts exist and differ, the paying account has sufficient
+     * funds and the receiving balance does not overflow, false otherwise.
+    */
+    bool transfer(int fromId, int toId, Money amount);
+
+    /**
+     * Moves an amount between the accounts two handles refer to, without id lookups.
+     * @param from A handle to the paying account.
+     * @param to A handle to the receiving account.
+     * @param amount A Money amount representing the amount to move.
+     * @return true if the transfer succeeded, false otherwise.
+    */
+    bool transfer(AccountHandle from, AccountHandle to, Money amount);
+
+    /**
+     * Applies a batch of transfers, each one atomic. The batch is sorted by the balance
+     * locks it needs, so consecutive transfers between the same accounts reuse the held
+     * locks, and the whole batch waits for the write-ahead log once. Transfers between
+     * the same pair of stripes keep their batch order; others may be reordered, so a
+     * transfer must not rely on the outcome of another one in the same batch. If the
+     * log fails, the transfers it lost are undone and reported as failed.
+     * @param batch A constant reference to the transfers to apply.
+     * @param succeeded Receives, for each transfer in batch order, whether it succeeded.
+     * @return The number of transfers that succeeded.
+    */
+    std::size_t transfer(const std::vector<Transfer> &batch, std::vector<bool> &succeeded);
+
+    /**
+     * Applies a batch of deposits and withdrawals in memory order instead of batch
+     * order. The ids are looked up in ascending order, the updates are then sorted by
+     * account slot, and each account is prefetched a few updates before it is changed,
+     * so a batch much larger than the cache costs a few sequential sweeps instead of
+     * two cache misses per update. Updates of the same account keep their batch order;
+     * updates of different accounts may be reordered. The whole batch waits for the
+     * write-ahead log once; if the log fails, the updates it lost are undone.
+     * @param batch A constant reference to the updates to apply.
+     * @param results Receives, for each update in batch order, its outcome.
+     * @return The number of updates applied.
+    */
+    std::size_t applyBatch(const std::vector<BalanceUpdate> &batch, std::vector<UpdateResult> &results);
+
+    /**
+     * Sums all account balances.
+     * @param total Receives the sum.
+     * @return false if the sum does not fit in a Money, true otherwise.
+    */
+    bool totalBalance(Money &total);
+
+    /**
+     * Counts the accounts whose balance is greater than a specified amount.
+     * @param minBalance A Money amount representing the exclusive minimum balance.
+    */
+    std::size_t countAccountsByBalance(Money minBalance);
+
+    /**
+     * Displays accounts filtered by name. Queries of three or more characters are
+     * answered from the trigram name index; shorter ones scan the name column.
      * @param A constant reference to a string representing the account holder's name.
+     * @param out The stream to display the accounts on.
     */    
-    void displayAccountsByName(const std::string &name);
+    void displayAccountsByName(const std::string &name, std::ostream &out = std::cout);
 
     /**
-     * Displays accounts filtered by balance greater than a specified amount
-     * @param A constant reference to a double representing the minimum balance.     
+     * Displays accounts filtered by balance greater than a specified amount,
+     * in ascending balance order.
+     * @param A constant reference to a Money amount representing the minimum balance.     
+     * @param out The stream to display the accounts on.
     */    
-    void displayAccountsByBalance(const double &balance);
+    void displayAccountsByBalance(const Money &balance, std::ostream &out = std::cout);
+
+    /**
+     * Displays accounts whose balance lies in [low, high), in ascending balance order.
+     * @param low A constant reference to a Money amount representing the inclusive lower bound.
+     * @param high A constant reference to a Money amount representing the exclusive upper bound.
+     * @param out The stream to display the accounts on.
+    */
+    void displayAccountsByBalance(const Money &low, const Money &high, std::ostream &out = std::cout);
 
     /**
-     * Deletes an account by its ID.
+     * Finds the accounts whose balance is greater than a specified amount.
+     * Costs O(log n + k) for k results through the balance index.
+     * @param minBalance A Money amount representing the exclusive minimum balance.
+     * @return The ids of the matching accounts in ascending balance order.
+    */
+    std::vector<int> findAccountsByBalance(Money minBalance);
+
+    /**
+     * Finds the accounts whose balance lies in the half-open range [low, high).
+     * Costs O(log n + k) for k results through the balance index.
+     * @param low A Money amount representing the inclusive lower bound.
+     * @param high A Money amount representing the exclusive upper bound.
+     * @return The ids of the matching accounts in ascending balance order.
+    */
+    std::vector<int> findAccountsByBalance(Money low, Money high);
+
+    /**
+     * Deletes an account by its ID in O(1). The account becomes a tombstone: it is
+     * gone from every lookup, scan and display at once, while its index entries and
+     * slot are reclaimed later by compact().
      * @param id An integer representing the account's unique ID.
+     * @param sequence If not null, the call returns as soon as the mutation is made,
+     * without waiting for the log, and this receives the sequence number to pass to
+     * whenDurable() and finishMutation(), or 0 if no log is open.
      * @return A boolean indicating if the account was successfully removed.
     */
-    bool deleteAccount(int id);
+    bool deleteAccount(int id, std::uint64_t *sequence = nullptr);
 
-    // Sorts accounts by account holder's name. Modifies the original vector
+    /**
+     * Reclaims deleted accounts in a bounded-time slice: removes up to maxSlots
+     * tombstones from the indexes and frees their slots. addAccount() also runs a
+     * small slice, so tombstones never pile up while the bank keeps growing.
+     * @param maxSlots The maximum number of tombstones to reclaim.
+     * @return The number of tombstones still waiting to be reclaimed.
+    */
+    std::size_t compact(std::size_t maxSlots);
+
+    // Lists accounts by account holder's name from now on. Storage order is not modified
     void sortAccountsByName();
 
-    // Sorts accounts by balance. Modifies the original vector
+    // Lists accounts by balance from now on. Storage order is not modified
     void sortAccountsByBalance();
 
-    // Sorts accounts by account ID. Modifies the original vector
+    // Lists accounts by account ID from now on. Storage order is not modified
     void sortAccountsById();
 
 private:
+    // The orders in which displayAccounts() can list the accounts.
+    enum class SortOrder { Storage, Name, Balance, Id };
+
+    static constexpr std::size_t BALANCE_STRIPES = 64;   // Number of balance locks
+    static constexpr std::size_t PREFETCH_DISTANCE = 16; // Updates between prefetching an account and changing it
+
+    // A lock over the balances of every account whose slot maps to it, with the
+    // balance changes not yet applied to the balance column and index. Stripes sit
+    // on separate cache lines so threads locking different stripes do not collide.
+    struct alignas(64) BalanceStripe {
+        std::mutex mutex;
+        std::vector<std::pair<std::uint32_t, Money>> changed; // (slot, balance the index still holds)
+    };
+
+    static constexpr std::size_t MIN_PENDING_PRUNE = 4096; // Logged mutations remembered before durable ones are dropped
+
+    // A logged mutation whose record is not known to be on disk yet, with what it
+    // takes to undo it should the log lose the record.
+    struct PendingChange {
+        // Describes a mutation; a deletion also keeps the account's balance and name.
+        PendingChange(const LogRecord &record, Money deletedBalance = Money(), std::string_view deletedName = {})
+            : record(record), deletedBalance(deletedBalance), deletedName(deletedName) {}
+
+        LogRecord record;                // The logged mutation
+        Money deletedBalance;            // Balance of a deleted account
+        std::string_view deletedName;    // Interned holder name of a deleted account
+        std::uint64_t sequence = 0;      // Sequence number of the record
+    };
+
+    /**
+     * Helper function to take the table lock exclusively and bring every derived
+     * structure up to date, as reports and checkpoints need
+     * @return The held lock
+    */
+    std::unique_lock<std::shared_mutex> lockForReport();
+
+    /**
+     * Helper function to return the stripe guarding an account's balance
+     * @param slot The slot of the account
+    */
+    BalanceStripe& stripeFor(std::uint32_t slot) const;
+
+    /**
+     * Helper function to remember that an account's balance is about to change, for
+     * the next report. The caller holds the table lock shared, and the slot's stripe
+     * lock unless updates are lock-free
+     * @param slot The slot of the account
+     * @param account The account, not yet changed
+    */
+    void noteBalanceChange(std::uint32_t slot, const Account &account);
+
+    // Helper function to tell whether balance updates skip the stripe locks right now
+    bool lockFree() const;
+
+    // Helper function to return the index of the stripe guarding an account's balance
+    std::size_t stripeIndex(std::uint32_t slot) const;
+
+    /**
+     * Helper function to lock the stripes of two accounts, lower stripe index first,
+     * the order every update of two accounts follows. Locks a shared stripe once
+     * @param a The slot of one account
+     * @param b The slot of the other account
+     * @param first Receives the lock on the lower stripe
+     * @param second Receives the lock on the higher stripe, if it differs
+    */
+    void lockStripes(std::uint32_t a, std::uint32_t b,
+                     std::unique_lock<std::mutex> &first, std::unique_lock<std::mutex> &second) const;
+
+    /**
+     * Helper function to check that money can move between two accounts whose balances
+     * the caller has locked
+     * @return true if the paying account has the funds and the receiving balance would not overflow
+    */
+    static bool canMoveBalance(const Account &from, const Account &to, Money amount);
+
+    /**
+     * Helper function to move money between two accounts whose balances the caller
+     * has locked, leaving both unchanged on failure
+     * @return true if the paying account had the funds and the receiving balance did not overflow
+    */
+    bool moveBalance(std::uint32_t fromSlot, Account &from, std::uint32_t toSlot, Account &to, Money amount);
+
+    /**
+     * Helper function behind deposit() and withdraw()
+     * @param handle A handle returned by findHandle()
+     * @param op LogOp::Deposit or LogOp::Withdraw
+     * @param amount A Money amount representing the amount to move
+     * @param sequence If not null, receives the log sequence number instead of waiting for it
+     * @return true if the account still exists and the update succeeded, false otherwise
+    */
+    bool changeBalance(AccountHandle handle, LogOp op, Money amount, std::uint64_t *sequence);
+
+    // Helper function to apply every noted balance change to the balance column and index, and mark
+    // the accounts dirty. The caller holds the table lock exclusively
+    void applyBalanceChanges();
+
+    /**
+     * Helper function behind addAccount(). The caller holds the table lock exclusively
+     * @param account A constant reference to an Account object to be added
+     * @param sequence Receives the log sequence number of the mutation, or 0
+     * @return A boolean indicating if the account was successfully added
+    */
+    bool addAccountLocked(const Account &account, std::uint64_t &sequence);
+
+    /**
+     * Helper function behind deleteAccount(). The caller holds the table lock exclusively
+     * @param id An integer representing the account's unique ID
+     * @param sequence Receives the log sequence number of the mutation, or 0
+     * @return A boolean indicating if the account was successfully removed
+    */
+    bool deleteAccountLocked(int id, std::uint64_t &sequence);
+
+    /**
+     * Helper function behind saveSnapshot(). The caller holds the lock returned by lockForReport()
+     * @param path The path of the snapshot file
+    */
+    bool saveSnapshotLocked(const std::string &path);
+
+    /**
+     * Helper function behind compact(). The caller holds the table lock exclusively
+     * @param maxSlots The maximum number of tombstones to reclaim
+    */
+    std::size_t compactLocked(std::size_t maxSlots);
+
+    /**
+     * Helper function to display a formatted list of accounts as a view saw them.
+     * Slots that were free in the view are skipped.
+     * @param accounts A constant reference to the view to read the accounts from
+     * @param slots A constant reference to a vector of slots, in display order
+     * @param out The stream to display them on
+    */
+    void displayAccountsFormatted(const AccountColumns::View &accounts, const std::vector<std::uint32_t> &slots, std::ostream &out);
+
+    /**
+     * Helper function to display the accounts stored at the given slots, in that
+     * order, from a view taken now. Tombstoned slots are skipped.
+     * @param table The lock returned by lockForReport(); released before printing
+     * @param slots A constant reference to a vector of slots in the account store
+     * @param out The stream to display them on
+    */
+    void displaySlotsFormatted(std::unique_lock<std::shared_mutex> &table, const std::vector<std::uint32_t> &slots, std::ostream &out);
+
+    /**
+     * Helper function to turn index results into account ids, skipping tombstones
+     * @param slots A constant reference to a vector of slots in the account store
+    */
+    std::vector<int> liveIds(const std::vector<std::uint32_t> &slots) const;
+
+    /**
+     * Helper function to store an account whose id is known to be free and add it to every index
+     * @param account A constant reference to the account to store
+     * @return The slot the account was stored in
+    */
+    std::uint32_t insertAccount(const Account &account);
+
+    /**
+     * Helper function to store a batch of accounts, skipping ids already present,
+     * and build the ordered indexes once from the whole batch
+     * @param rows A constant reference to a vector of parsed accounts
+     * @param logged If not null, each account is written to the write-ahead log before
+     * it is added, stopping at the first record the log refuses, and this receives
+     * the ids of the added accounts in log order
+     * @param changed true if the accounts are new since the last checkpoint, false if
+     * they come from the snapshot it wrote and need no delta
+     * @return The number of accounts added
+    */
+    std::size_t insertRows(const std::vector<AccountRow> &rows, std::vector<int> *logged, bool changed);
+
+    /**
+     * Helper function to find an account of the open snapshot that is neither loaded nor deleted
+     * @param id An integer representing the account's unique ID
+     * @return The snapshot row of the account, or Snapshot::NOT_FOUND
+    */
+    std::size_t pendingSnapshotRow(int id) const;
+
+    /**
+     * Helper function to mark a snapshot row as loaded or deleted
+     * @param row A row returned by pendingSnapshotRow()
+    */
+    void claimSnapshotRow(std::size_t row);
+
+    /**
+     * Helper function to load a single account from the open snapshot
+     * @param id An integer representing the account's unique ID
+     * @return The slot the account was loaded into, or UINT32_MAX if it is not pending in the snapshot
+    */
+    std::uint32_t loadFromSnapshot(int id);
+
+    // Helper function to load every pending account of the open snapshot, then close it
+    void loadSnapshot();
+
+    /**
+     * Helper function to log a mutation that is about to be made, and remember how to
+     * undo it until its record is durable. The caller holds the table lock, and makes
+     * the mutation under it only if this succeeds
+     * @param change The mutation, with the deleted account's balance and name for a deletion
+     * @param sequence Receives the record's sequence number, or 0 if no log is open
+     * @return false if a log is open but refuses the record, true otherwise
+    */
+    bool logChange(PendingChange change, std::uint64_t &sequence);
+
+    /**
+     * Helper function to wait, without holding any lock, until a logged mutation is
+     * durable. If it never will be, every mutation the log lost is undone
+     * @param sequence A sequence number returned by logChange()
+     * @return true if no log is open or the record is durable, false otherwise
+    */
+    bool logWait(std::uint64_t sequence);
+
+    /**
+     * Helper function to wait until every logged mutation is durable, undoing the
+     * ones the log lost. The caller holds the table lock exclusively
+     * @return true if no log is open or nothing was lost, false otherwise
+    */
+    bool settleLog();
+
+    // Helper function to undo, newest first, every mutation whose record the log lost.
+    // The caller holds the table lock exclusively
+    void rollBackLostChanges();
+
+    /**
+     * Helper function to undo one mutation on the state it left the bank in. The
+     * caller holds the table lock exclusively
+     * @param change A constant reference to the mutation to undo
+    */
+    void undoChange(const PendingChange &change);
+
+    /**
+     * Helper function to take a live account out of the id index, the columns and
+     * the store, leaving a tombstone for compact(). The caller holds the table lock exclusively
+     * @param slot The slot of the account
+    */
+    void dropAccount(std::uint32_t slot);
+
+    /**
+     * Helper function to apply a delta snapshot to the bank
+     * @param delta A constant reference to the open delta snapshot
+    */
+    void applyDelta(const Snapshot &delta);
+
+    /**
+     * Helper function to write the accounts changed since the last checkpoint as a delta snapshot
+     * @param basePath The path of the base snapshot the delta extends
+     * @param sequence The last log record the delta reflects
+     * @return true if the delta was written or there was nothing to write, false otherwise
+    */
+    bool writeDelta(const std::string &basePath, std::uint64_t sequence);
+
+    /**
+     * Helper function to remember that an account changed since the last checkpoint
+     * @param slot The slot of the changed account
+    */
+    void markDirty(std::uint32_t slot);
+
+    // Helper function to forget every change once a checkpoint reflects it
+    void clearDirty();
+
     /**
-     * Helper function to display a formatted list of accounts
-     * @param accounts A constant reference to a vector of Account objects
+     * Helper function to apply a mutation read back from the write-ahead log
+     * @param record A constant reference to the record to replay
     */
-    void displayAccountsFormatted(const std::vector<Account> &accounts);
+    void replay(const LogRecord &record);
 
-    std::vector<Account> accounts; // Container for storing bank accounts
+    AccountStore store;                              // Slab storing the bank accounts
+    std::unordered_map<int, std::uint32_t> slotById; // Account id -> slot in store
+    AccountColumns columns;                          // Columnar copy of accounts for scans
+    NameIndex nameIndex;                             // Trigram index over holder names
+    BalanceIndex balanceIndex;                       // Accounts ordered by (balance, slot)
+    SortedViews views;                               // Accounts ordered by name and by id
+    std::vector<std::uint32_t> tombstones;           // Deleted slots waiting for compact()
+    SortOrder displayOrder = SortOrder::Storage;     // Order used by displayAccounts()
+    Snapshot snapshot;                               // Snapshot accounts are loaded from on demand
+    std::vector<std::uint8_t> snapshotClaimed;       // 1 for snapshot rows already loaded or deleted
+    std::size_t snapshotPending = 0;                 // Snapshot rows neither loaded nor deleted
+    std::uint64_t snapshotSequence = 0;              // Last log record the opened snapshot reflects
+    WriteAheadLog log;                               // Makes mutations durable once opened
+    bool logging = false;                            // Set once openLog() has replayed the log
+    std::mutex pendingMutex;                         // Guards the two members below
+    std::vector<PendingChange> pendingChanges;       // Logged mutations possibly not durable yet
+    std::size_t pendingPruneAt = MIN_PENDING_PRUNE;  // Size at which durable ones are dropped
+    std::string checkpointBase;                      // Snapshot that checkpoint() extends with deltas
+    std::vector<std::uint8_t> dirty;                 // 1 for slots changed since the last checkpoint
+    std::vector<std::uint32_t> dirtySlots;           // The slots marked in dirty, in marking order
+    std::vector<int> deletedIds;                     // Ids deleted since the last checkpoint
+    SnapshotMerger merger;                           // Folds deltas into the base snapshot
+    mutable std::shared_mutex tableMutex;            // Guards every member above except balances
+    mutable std::array<BalanceStripe, BALANCE_STRIPES> stripes; // Balance locks, by slot
+    std::vector<std::uint8_t> balanceNoted;          // 1 for slots with a change in their stripe; read atomically
+    const ConcurrencyMode mode;                      // How balance updates are serialized
 };
 
 #endif // BANK_H
@@ -1,221 +1,128 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include "Account.cpp"
-#include "Bank.cpp"
+#include <csignal>
+#include <thread>
+#include "BankEngine.cpp"
+#include "MenuSession.cpp"
+#include "AtmMenu.cpp"
+#include "AtmServer.cpp"
 #include "Utility.cpp"
 
-// Constants defining the expected length of account numbers and PINs.
-const int ACCOUNT_LENGTH = 7;
-const int PIN_LENGTH = 4;
-
-// Utility object for various helper functions like input validation.
-Utility utility;
+// Number of threads serving ATM sessions in server mode.
+const std::size_t SERVER_WORKERS = 4;
 
 /**
- * Function: clientMenu
- * Purpose: Handles the menu and actions for a bank client.
- * Parameters:
- *   - Bank &bank: Reference to the Bank object, facilitating account operations.
- * 
- * Description: 
- *   This function provides a menu for the client to perform various operations 
- *   such as checking balance, depositing money, and withdrawing money. It also 
- *   handles PIN verification and account selection for the client.
+ * Serves ATM sessions over a Unix domain socket until the process receives
+ * SIGINT or SIGTERM. See AtmServer for the protocols.
+ * @param bank Reference to the Bank object every session works against.
+ * @param socketPath The path of the socket file to listen on.
+ * @param protocol The request protocol, or the interactive menus.
+ * @return true if the server ran, false if it could not listen.
  */
-void clientMenu(Bank &bank) {
-    // Client PIN authentication
-    std::string pin;
-    std::cout << "Enter your 4 digit pin: ";
-    std::cin >> pin;
-    if(!utility.verifyNumber(pin, PIN_LENGTH)) return; // Validates the PIN length.
-
-    // Dummy account for fast testing purposes. In a real scenario, this would be replaced
-    // by an account lookup based on the authenticated client.
-    Account* account = bank.findAccount(1111111);
-    if (account == nullptr) {
-        std::cout << "\033[31mAccount not found.\n\033[0m";
-        return; // Exit if account is not found.
-    }
-
-    // Client operations menu
-    int choice;
-    std::cout << "1. Check Balance\n2. Deposit Money\n3. Withdraw Money\nEnter choice: ";
-    choice = utility.getNumber(); // Utility function to get a valid number.
-    system("clear"); // Clears the console for clean output.
-
-    double amount; // Variable to store the amount for transactions.
-    switch (choice) {
-        case 1:
-            // Display the current account balance.
-            std::cout << "Your balance is: \033[32m$" << account->getBalance() << "\n\033[0m";
-            break;
-        case 2:
-            // Handle deposit operation.
-            std::cout << "Enter deposit amount: ";
-            std::cin >> amount;
-            account->deposit(amount); // Deposit the specified amount.
-            break;
-        case 3:
-            // Handle withdrawal operation.
-            std::cout << "Enter withdrawal amount: ";
-            std::cin >> amount;
-            if (!account->withdraw(amount)) {
-                std::cout << "\033[31mInsufficient funds.\n\033[0m";
-            }
-            break;
-        default:
-            // Handle invalid choice.
-            std::cout << "\033[31mInvalid choice.\n\033[0m";
+bool serveSessions(Bank &bank, const std::string &socketPath, AtmServer::Protocol protocol) {
+    // Block the stop signals before any thread starts, so only sigwait() receives them.
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    AtmServer server(bank, SERVER_WORKERS, protocol);
+    if (!server.listen(socketPath)) {
+        std::cout << "\033[31mCould not listen on " << socketPath << "\n\033[0m";
+        return false;
     }
+    std::thread loop([&server] { server.run(); });
+    std::cout << "Serving ATM sessions on " << socketPath << "\n";
+    int received;
+    sigwait(&stopSignals, &received);
+    server.stop();
+    loop.join();
+    return true;
 }
 
-
-/** 
- * This function presents a menu to the banker, allowing them to perform
- * various administrative operations such as managing accounts, searching
- * by name or balance, and sorting accounts.
- * @param bank Reference to the Bank object for managing accounts. 
+/**
+ * Runs the console menus for one user on standard input.
+ * @param bank Reference to the Bank object the user works with.
  */
-void bankerMenu(Bank &bank) {
-    int choice;
-    std::cout << "1. Display all customers\n2. Delete an account\n3. Add a new account\n"
-              << "4. Search by name\n5. Search by balance greater than\n"
-              << "6. Sort accounts by name\n7. Sort accounts by balance\n"
-              << "8. Sort accounts by ID\nEnter choice: ";
-    choice = utility.getNumber(); // Gets the choice of the banker
-
-    // Variables to hold account details
-    std::string accountId, searchName, name;
-    double balance;
-
-    switch (choice) {
-        case 1:
-            // Display all bank accounts
-            bank.displayAccounts();
-            break;
-        case 2:
-            // Delete an account by its ID
-            std::cout << "Enter account ID to delete: ";
-            std::cin >> accountId;
-            if(utility.verifyNumber(accountId, ACCOUNT_LENGTH)) {
-                if(bank.deleteAccount(std::stoi(accountId)))
-                    std::cout << "\033[32mAccount successfully deleted.\n\033[0m";
-                else
-                    std::cout << "\033[31mAccount not found.\n\033[0m";
-            }
-            break;
-        case 3:
-            // Add a new account
-            std::cout << "Enter new account ID (7 digits): ";
-            std::cin >> accountId;
-            if(utility.verifyNumber(accountId, ACCOUNT_LENGTH)) {
-                std::cout << "Enter initial Balance: ";
-                balance = utility.getAmount();
-                if(balance >= 0) {
-                    std::cout << "Enter the Name of the Client: ";
-                    utility.clearCinBuffer();
-                    std::getline(std::cin, name);
-                    bank.addAccount(Account(std::stoi(accountId), balance, name));
-                } else {
-                    std::cout << "\033[31mInvalid amount.\n\033[0m";
-                }
-            }
-            break;
-        case 4:
-            // Search accounts by name
-            std::cout << "Enter name to search: ";
-            utility.clearCinBuffer();
-            std::getline(std::cin, searchName);
-            if (!searchName.empty()) {
-                bank.displayAccountsByName(searchName);
-            } else {
-                std::cout << "\033[31mName cannot be empty.\n\033[0m";
-            }
-            break;
-        case 5:
-            // Search accounts by a minimum balance
-            std::cout << "Enter minimum balance: ";
-            balance = utility.getAmount();
-            if(balance >= 0) {
-                bank.displayAccountsByBalance(balance);
-            } else {
-                std::cout << "\033[31mInvalid amount.\n\033[0m";
-            }
-            break;
-        case 6:
-            // Sort and display accounts by name
-            bank.sortAccountsByName();
-            bank.displayAccounts();
-            break;
-        case 7:
-            // Sort and display accounts by balance
-            bank.sortAccountsByBalance();
-            bank.displayAccounts();
-            break;
-        case 8:
-            // Sort and display accounts by ID
-            bank.sortAccountsById();
-            bank.displayAccounts();
-            break;
-        default:
-            // Handle invalid choice
-            std::cout << "\033[31mInvalid choice.\n\033[0m";
+void consoleSession(Bank &bank) {
+    AtmMenu menu(bank);
+    MenuSession session;
+    // The console serves no one else, so the flow may wait for its commits itself:
+    // Bank::finishMutation() blocks until the commit is settled.
+    auto finishCommits = [&session] {
+        while (session.awaitedCommit() != 0) session.committed();
+    };
+    session.start(menu.run(session));
+    std::cout << session.takeOutput() << std::flush;
+
+    // Feed the session one line at a time until it ends or the input does.
+    std::string line;
+    while (!session.finished() && std::getline(std::cin, line)) {
+        session.deliver(std::move(line));
+        finishCommits();
+        std::cout << session.takeOutput() << std::flush;
     }
+    session.closeInput();
+    std::cout << session.takeOutput();
 }
 
 /**
  * Entry point for the Dummy Bank application.
  *
- * This function sets up a simple banking application with predefined accounts.
- * It allows users to interact with the bank system as either a client or a banker.
+ * This function sets up a simple banking application with predefined accounts, or
+ * with the accounts of the file given as the first argument: a binary snapshot
+ * saved from the banker menu (".snap"), or a CSV file ("id,name,balance" per line). It allows users to interact with the bank system as either a client or a banker.
+ * Started as "--serve <socket> [file]", it serves ATM sessions over a Unix domain
+ * socket instead, until interrupted; "--serve-menus <socket> [file]" serves the
+ * interactive menus to each connection.
  */
-int main() {
+int main(int argc, char *argv[]) {
     // Instantiate a bank object to manage various accounts.
     Bank bank;
 
-    // Add sample accounts to the bank for demonstration purposes.
-    bank.addAccount(Account(1111111, 1040.45, "Alex Johnson")); // Account 1
-    bank.addAccount(Account(3456547, 100000, "Samantha Green")); // Account 2
-    bank.addAccount(Account(6455742, 100, "Jordan Smith")); // Account 3
-    bank.addAccount(Account(9823454, 0.04, "Taylor Davis")); // Account 4
-    bank.addAccount(Account(5423244, 500, "Morgan Lee")); // Account 5
-    bank.addAccount(Account(9823413, 5050, "Casey Brown")); // Account 6
+    std::string socketPath;
+    AtmServer::Protocol protocol = AtmServer::Protocol::Requests;
+    if (argc > 2 && (std::string(argv[1]) == "--serve" || std::string(argv[1]) == "--serve-menus")) {
+        if (std::string(argv[1]) == "--serve-menus") protocol = AtmServer::Protocol::Menus;
+        socketPath = argv[2];
+        argv += 2; // The accounts file, if any, becomes argv[1].
+        argc -= 2;
+    }
 
-    // Variable to store user's role choice.
-    int userType;
+    std::string file = argc > 1 ? argv[1] : "";
+    bool fromSnapshot = file.size() > 5 && file.compare(file.size() - 5, 5, ".snap") == 0;
+    if (fromSnapshot) {
+        // Map the snapshot; accounts are loaded as they are used. Then replay the
+        // changes logged since it was saved, and log every change from now on.
+        if (!bank.openSnapshot(file) || !bank.openLog(file + ".wal")) {
+            std::cout << "\033[31mCould not open snapshot " << file << "\n\033[0m";
+            return 1;
+        }
+    } else if (argc > 1) {
+        // Load the accounts from the given file.
+        std::size_t loaded = bank.bulkLoad(argv[1]);
+        std::cout << "Loaded " << loaded << " accounts from " << argv[1] << "\n";
+    } else {
+        // Add sample accounts to the bank for demonstration purposes.
+        bank.addAccount(Account(1111111, Money(1040, 45), "Alex Johnson")); // Account 1
+        bank.addAccount(Account(3456547, Money(100000, 0), "Samantha Green")); // Account 2
+        bank.addAccount(Account(6455742, Money(100, 0), "Jordan Smith")); // Account 3
+        bank.addAccount(Account(9823454, Money(0, 4), "Taylor Davis")); // Account 4
+        bank.addAccount(Account(5423244, Money(500, 0), "Morgan Lee")); // Account 5
+        bank.addAccount(Account(9823413, Money(5050, 0), "Casey Brown")); // Account 6
+    }
 
-    // Clear the console and display the welcome message.
-    system("clear");
-    std::cout << "\033[34m\t\tWelcome to Dummy Bank! \033[0m\n"
-              << "Which role would you like to sign in as:\n1. Client \n2. Banker\n\n";
-    std::cin >> userType; // Read user's choice.
-    system("clear"); // Clear the console for clean output.
+    if (!socketPath.empty()) {
+        if (!serveSessions(bank, socketPath, protocol)) return 1;
+    } else {
+        consoleSession(bank);
+    }
 
-    // Main interaction loop based on user role.
-    switch (userType) {
-        case 1: // Client Role
-            while (true) {
-                clientMenu(bank); // Execute client-specific actions.
-                std::cout << "Would you like to continue? Y or N \n";
-                char selection;
-                std::cin >> selection;
-                if (selection != 'y' && selection != 'Y') break; // Exit loop if no longer continue.
-                system("clear"); // Clear the console.
-            }
-            break;
-        case 2: // Banker Role
-            while (true) {
-                bankerMenu(bank); // Execute banker-specific actions.
-                std::cout << "Would you like to continue? Y or N\n";
-                char selection;
-                std::cin >> selection;
-                if (selection != 'y' && selection != 'Y') break; // Exit loop if no longer continue.
-                system("clear"); // Clear the console.
-            }
-            break;
-        default: // Invalid Choice
-            std::cout << "\033[31m Invalid choice.\n \033[0m"; // Display error for invalid choice.
+    // Fold the logged changes into the snapshot so the next start has nothing to replay.
+    if (fromSnapshot && !bank.checkpoint(file)) {
+        std::cout << "\033[31mCould not update snapshot " << file << "\n\033[0m";
     }
 
     // End of the application.
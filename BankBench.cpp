@@ -0,0 +1,1023 @@
+#include <iostream>
+#include <memory>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <atomic>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BankEngine.cpp"
+#include "ShardedBank.cpp"
+#include "MenuSession.cpp"
+#include "AtmMenu.cpp"
+#include "AtmServer.cpp"
+#include "Utility.cpp"
+
+// Benchmarks for the Bank engine. Build with optimizations, e.g.
+//   g++ -std=c++20 -O3 -march=native -pthread BankBench.cpp -o BankBench
+// and run with an optional upper bound on the account count, and --json for
+// machine-readable results:
+//   ./BankBench 10000000 --json
+
+using Clock = std::chrono::steady_clock;
+
+// Number of random lookups timed per bank size.
+const int LOOKUPS = 1000000;
+
+// Number of heap allocations made by the whole program so far.
+std::atomic<std::size_t> allocationCount{0};
+
+// Whether results are printed as a JSON array instead of a table.
+bool jsonOutput = false;
+
+/**
+ * Allocates heap memory for the replacement allocation functions below and counts it.
+ * @param size The number of bytes.
+ * @param alignment The alignment, or 0 for the default of malloc.
+ * @return The memory, or nullptr if there is none left.
+ */
+static void* countedAllocate(std::size_t size, std::size_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (alignment == 0) return std::malloc(size);
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+/**
+ * Frees memory from countedAllocate(). Never inlined into a delete expression, so
+ * the compiler does not see free() paired with operator new.
+ */
+__attribute__((noinline)) static void countedFree(void *p) noexcept {
+    std::free(p);
+}
+
+// Counting replacements for every global allocation function, plain, array, aligned
+// and nothrow, so that whatever form the program uses is counted and freed alike.
+void* operator new(std::size_t size) {
+    if (void *p = countedAllocate(size, 0)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void *p = countedAllocate(size, 0)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void *p = countedAllocate(size, static_cast<std::size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void *p = countedAllocate(size, static_cast<std::size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept { countedFree(p); }
+void operator delete[](void *p) noexcept { countedFree(p); }
+void operator delete(void *p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void *p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+
+// Keeps the optimizer from discarding results the benchmark never uses.
+volatile long long sink;
+
+// Forces the compiler to assume memory changed, so repeated passes are not merged.
+inline void clobberMemory() {
+    asm volatile("" ::: "memory");
+}
+
+// Discards everything written to it, so reports can be timed without a terminal.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+NullBuffer nullBuffer;
+std::ostream nullSink(&nullBuffer);
+
+// The moment a measurement started, in time and in heap allocations.
+struct Stopwatch {
+    Clock::time_point start = Clock::now();
+    std::size_t allocations = allocationCount;
+};
+
+// What a measurement took: wall-clock seconds and heap allocations.
+struct Sample {
+    double seconds;
+    std::size_t allocations;
+};
+
+/**
+ * Returns the time and allocations since a measurement started.
+ */
+Sample sampleSince(const Stopwatch &start) {
+    return {std::chrono::duration<double>(Clock::now() - start.start).count(), allocationCount - start.allocations};
+}
+
+/**
+ * Returns the stream for remarks that are not results, kept out of the JSON output.
+ */
+std::ostream& notes() {
+    return jsonOutput ? std::cerr : std::cout;
+}
+
+/**
+ * Prints one result, as a line of a fixed-width table or as an element of the JSON array.
+ * @param name The name of the measured operation.
+ * @param accounts The number of accounts in the bank during the measurement.
+ * @param ops The number of operations that were measured.
+ * @param sample The time and allocations the operations took.
+ */
+void report(const std::string &name, long long accounts, long long ops, Sample sample) {
+    static bool first = true;
+    double nsPerOp = sample.seconds * 1e9 / ops;
+    double opsPerSecond = ops / sample.seconds;
+    double allocationsPerOp = double(sample.allocations) / ops;
+    if (jsonOutput) {
+        std::cout << (first ? "[\n" : ",\n") << std::fixed << std::setprecision(3)
+                  << "  {\"name\": \"" << name << "\", \"accounts\": " << accounts << ", \"ops\": " << ops
+                  << ", \"ns_per_op\": " << nsPerOp << ", \"ops_per_sec\": " << opsPerSecond
+                  << ", \"allocs_per_op\": " << allocationsPerOp << "}";
+    } else {
+        std::cout << std::left << std::setw(28) << name << std::right << std::setw(12) << accounts
+                  << std::setw(14) << std::fixed << std::setprecision(1) << nsPerOp << " ns/op"
+                  << std::setw(16) << std::setprecision(0) << opsPerSecond << " ops/s"
+                  << std::setw(12) << std::setprecision(2) << allocationsPerOp << " allocs/op\n";
+    }
+    first = false;
+}
+
+/**
+ * Returns the synthetic balance of the i-th account: 0.00 to 9999.90 in steps of 0.10.
+ */
+Money syntheticBalance(int i) {
+    return Money::fromMinorUnits((i % 100000) * 10LL);
+}
+
+/**
+ * Fills a bank with consecutive synthetic accounts.
+ * @param bank The bank to populate.
+ * @param count The number of accounts to add.
+ */
+void populate(Bank &bank, int count) {
+    for (int i = 0; i < count; ++i) {
+        bank.addAccount(Account(Workload::FIRST_ID + i, syntheticBalance(i), "Holder " + std::to_string(i)));
+    }
+}
+
+/**
+ * Times random findAccount hits against a bank of the given size.
+ * With the hash index the per-lookup cost should stay flat as the bank grows.
+ */
+void benchFindAccount(int count) {
+    Bank bank;
+    Stopwatch start;
+    populate(bank, count);
+    report("addAccount", count, count, sampleSince(start));
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(Workload::FIRST_ID, Workload::FIRST_ID + count - 1);
+    std::vector<int> ids(LOOKUPS);
+    for (auto &id : ids) id = pick(rng);
+
+    long long found = 0;
+    start = Stopwatch();
+    for (int id : ids) {
+        found += bank.findAccount(id) != nullptr;
+    }
+    report("findAccount", count, LOOKUPS, sampleSince(start));
+    sink = found;
+}
+
+/**
+ * Compares a balance filter and a balance total over a vector of Account rows,
+ * as Bank did before it kept columns, with the same work over AccountColumns.
+ */
+void benchBalanceScan(int count) {
+    std::vector<Account> rows;
+    AccountColumns columns;
+    rows.reserve(count);
+    columns.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Account acc(Workload::FIRST_ID + i, syntheticBalance(i), "Holder " + std::to_string(i));
+        rows.push_back(acc);
+        columns.assign(i, acc);
+    }
+    const Money minBalance(9000, 0); // Matches about 10% of the synthetic accounts.
+    const int passes = 10;
+
+    Stopwatch start;
+    long long matches = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const auto &acc : rows) {
+            if (acc.getBalance() > minBalance) ++matches;
+        }
+        clobberMemory();
+    }
+    report("balanceFilter rows", count, (long long)count * passes, sampleSince(start));
+
+    start = Stopwatch();
+    for (int pass = 0; pass < passes; ++pass) {
+        matches += columns.slotsWithBalanceAbove(minBalance).size();
+        clobberMemory();
+    }
+    report("balanceFilter columns", count, (long long)count * passes, sampleSince(start));
+
+    start = Stopwatch();
+    long long total = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const auto &acc : rows) total += acc.getBalance().minorUnits();
+        clobberMemory();
+    }
+    report("balanceSum rows", count, (long long)count * passes, sampleSince(start));
+
+    start = Stopwatch();
+    for (int pass = 0; pass < passes; ++pass) {
+        Money sum;
+        columns.totalBalance(sum);
+        total += sum.minorUnits();
+        clobberMemory();
+    }
+    report("balanceSum columns", count, (long long)count * passes, sampleSince(start));
+    sink = matches + total;
+}
+
+/**
+ * Compares the integer balance total of AccountColumns with the same total over
+ * a contiguous column of doubles, as balances were stored before Money.
+ */
+void benchMoneySum(int count) {
+    AccountColumns columns;
+    std::vector<double> doubles(count);
+    columns.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Money balance = syntheticBalance(i);
+        columns.assign(i, Account(Workload::FIRST_ID + i, balance, ""));
+        doubles[i] = balance.minorUnits() / 100.0;
+    }
+    const int passes = 10;
+
+    Stopwatch start;
+    double doubleTotal = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (double balance : doubles) doubleTotal += balance;
+        clobberMemory();
+    }
+    report("balanceSum double", count, (long long)count * passes, sampleSince(start));
+
+    start = Stopwatch();
+    long long moneyTotal = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        Money sum;
+        columns.totalBalance(sum);
+        moneyTotal += sum.minorUnits();
+        clobberMemory();
+    }
+    report("balanceSum Money", count, (long long)count * passes, sampleSince(start));
+    sink = moneyTotal + static_cast<long long>(doubleTotal);
+}
+
+/**
+ * Compares a substring search over the name column with the trigram name index.
+ */
+void benchNameSearch(int count) {
+    AccountColumns columns;
+    NameIndex index;
+    columns.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Account acc(Workload::FIRST_ID + i, Money(), "Holder " + std::to_string(i));
+        columns.assign(i, acc);
+        index.add(i, acc.getName());
+    }
+    const std::string query = "4242"; // Rare enough to be a realistic teller search.
+    const int searches = 20;
+
+    Stopwatch start;
+    long long matches = 0;
+    for (int i = 0; i < searches; ++i) {
+        matches += columns.slotsWithNameContaining(query).size();
+    }
+    report("nameSearch scan", count, searches, sampleSince(start));
+
+    start = Stopwatch();
+    for (int i = 0; i < searches; ++i) {
+        matches += index.matches(query).size();
+    }
+    report("nameSearch trigram", count, searches, sampleSince(start));
+    sink = matches;
+}
+
+/**
+ * Compares a "balance greater than" report answered by scanning the balance
+ * column with the same report answered from the ordered balance index.
+ */
+void benchBalanceRange(int count) {
+    Bank bank;
+    populate(bank, count);
+    const Money minBalance(9990, 0); // Matches about 0.1% of the synthetic accounts.
+    const int queries = 20;
+
+    Stopwatch start;
+    long long matches = 0;
+    for (int i = 0; i < queries; ++i) {
+        matches += bank.countAccountsByBalance(minBalance);
+        clobberMemory();
+    }
+    report("balanceAbove scan", count, queries, sampleSince(start));
+
+    start = Stopwatch();
+    for (int i = 0; i < queries; ++i) {
+        matches += bank.findAccountsByBalance(minBalance).size();
+    }
+    report("balanceAbove index", count, queries, sampleSince(start));
+    sink = matches;
+}
+
+/**
+ * Times deleting every other account, then reclaiming the tombstones in slices.
+ */
+void benchDeleteAccount(int count) {
+    Bank bank;
+    populate(bank, count);
+    const std::size_t slice = 1024;
+
+    Stopwatch start;
+    for (int i = 0; i < count; i += 2) {
+        bank.deleteAccount(Workload::FIRST_ID + i);
+    }
+    long long deletes = (count + 1) / 2;
+    report("deleteAccount", count, deletes, sampleSince(start));
+
+    start = Stopwatch();
+    long long slices = 0;
+    while (bank.compact(slice) > 0) ++slices;
+    report("compact slice", count, slices + 1, sampleSince(start));
+}
+
+/**
+ * Times every sorted listing and filtered report a banker can ask for, written to a
+ * null sink so the formatting is measured without a terminal. A sort only picks
+ * the order of the next listing, so each sort is timed together with its listing.
+ */
+void benchSortsAndReports(int count) {
+    Bank bank;
+    populate(bank, count);
+    const int listings = std::max(1, 100000 / count); // At least 100k rows per measurement.
+
+    auto timeListing = [&bank, count, listings](const std::string &name, void (Bank::*sortAccounts)()) {
+        Stopwatch start;
+        for (int i = 0; i < listings; ++i) {
+            (bank.*sortAccounts)();
+            bank.displayAccounts(nullSink);
+        }
+        report(name, count, listings, sampleSince(start));
+    };
+    timeListing("sortAccountsByName", &Bank::sortAccountsByName);
+    timeListing("sortAccountsByBalance", &Bank::sortAccountsByBalance);
+    timeListing("sortAccountsById", &Bank::sortAccountsById);
+
+    const int queries = 20;
+    Stopwatch start;
+    for (int i = 0; i < queries; ++i) bank.displayAccountsByName("4242", nullSink);
+    report("displayAccountsByName", count, queries, sampleSince(start));
+
+    start = Stopwatch();
+    for (int i = 0; i < queries; ++i) bank.displayAccountsByBalance(Money(9990, 0), nullSink);
+    report("displayAccountsByBalance", count, queries, sampleSince(start));
+
+    start = Stopwatch();
+    for (int i = 0; i < queries; ++i) bank.displayAccountsByBalance(Money(5000, 0), Money(5010, 0), nullSink);
+    report("displayAccountsByBalance rng", count, queries, sampleSince(start));
+}
+
+/**
+ * Sorts accounts by holder name and counts heap allocations per sort, comparing
+ * the interned string_view names with comparisons that copy each name into a
+ * std::string, as getName() returning by value used to do.
+ */
+void benchNameSort(int count) {
+    std::vector<Account> accounts;
+    accounts.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        // Long enough to defeat the small-string optimization of std::string.
+        accounts.emplace_back(Workload::FIRST_ID + i, Money(), "Account Holder Number " + std::to_string(count - i));
+    }
+    std::vector<const Account*> order;
+    for (const auto &acc : accounts) order.push_back(&acc);
+
+    Stopwatch start;
+    std::sort(order.begin(), order.end(), [](const Account *a, const Account *b) {
+        return std::string(a->getName()) < std::string(b->getName());
+    });
+    report("nameSort copied", count, 1, sampleSince(start));
+
+    std::reverse(order.begin(), order.end());
+    start = Stopwatch();
+    std::sort(order.begin(), order.end(), [](const Account *a, const Account *b) {
+        return a->getName() < b->getName();
+    });
+    report("nameSort interned", count, 1, sampleSince(start));
+}
+
+/**
+ * Times one way of sorting a copy of some (key, slot) pairs and checks the result.
+ * @param name The name to report the result under.
+ * @param pairs The pairs to sort; left unchanged.
+ * @param sortPairs Sorts a vector of pairs in place.
+ */
+template <typename Pair, typename SortPairs>
+void timeSort(const std::string &name, const std::vector<Pair> &pairs, SortPairs sortPairs) {
+    std::vector<Pair> copy = pairs;
+    Stopwatch start;
+    sortPairs(copy);
+    Sample sample = sampleSince(start);
+    report(name, pairs.size(), pairs.size(), sample);
+    if (!std::is_sorted(copy.begin(), copy.end())) notes() << name << " left the pairs out of order\n";
+}
+
+/**
+ * Keeps many client menu sessions alive on one thread and feeds them input lines
+ * round-robin, as an event loop would, reporting the time per line handled. Each
+ * round deposits into the shared account and answers "continue" with yes.
+ * @param sessionCount The number of sessions suspended at once.
+ * @param rounds The number of deposit rounds each session runs.
+ */
+void benchMenuSessions(int sessionCount, int rounds) {
+    Bank bank;
+    bank.addAccount(Account(1111111, Money(), "Alex Johnson"));
+    AtmMenu menu(bank);
+    const char *script[] = {"1234", "2", "1.00", "y"};
+    std::vector<std::unique_ptr<MenuSession>> sessions;
+    Stopwatch start;
+    for (int i = 0; i < sessionCount; ++i) {
+        sessions.push_back(std::make_unique<MenuSession>());
+        sessions.back()->start(menu.run(*sessions.back()));
+        sessions.back()->deliver("1"); // Sign in as a client.
+        sink = sink + sessions.back()->takeOutput().size();
+    }
+    Sample started = sampleSince(start);
+
+    start = Stopwatch();
+    for (int round = 0; round < rounds; ++round) {
+        for (const char *line : script) {
+            for (auto &session : sessions) {
+                session->deliver(line);
+                sink = sink + session->takeOutput().size();
+            }
+        }
+    }
+    Sample lines = sampleSince(start);
+    report("menu session start", sessionCount, sessionCount, started);
+    report("menu session line", sessionCount, (long long)sessionCount * rounds * 4, lines);
+    Money balance;
+    bank.checkBalance(bank.findHandle(1111111), balance);
+    if (balance != Money::fromMinorUnits(100LL * sessionCount * rounds)) notes() << "menu sessions lost deposits\n";
+}
+
+/**
+ * Compares std::sort with ParallelSort on (key, slot) pairs like the ones the id,
+ * balance and name indexes are bulk-built from: slots ascending, keys shuffled.
+ * Times are per sorted pair.
+ */
+void benchIndexSorts(int count) {
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i) names.push_back("Holder " + std::to_string(i));
+    std::vector<int> keys(count);
+    for (int i = 0; i < count; ++i) keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    std::vector<std::pair<int, std::uint32_t>> ids;
+    std::vector<std::pair<Money, std::uint32_t>> balances;
+    std::vector<std::pair<std::string_view, std::uint32_t>> byName;
+    ids.reserve(count);
+    balances.reserve(count);
+    byName.reserve(count);
+    for (std::uint32_t slot = 0; slot < keys.size(); ++slot) {
+        ids.emplace_back(Workload::FIRST_ID + keys[slot], slot);
+        balances.emplace_back(syntheticBalance(keys[slot]), slot);
+        byName.emplace_back(names[keys[slot]], slot);
+    }
+    using IdPairs = std::vector<std::pair<int, std::uint32_t>>;
+    using BalancePairs = std::vector<std::pair<Money, std::uint32_t>>;
+    using NamePairs = std::vector<std::pair<std::string_view, std::uint32_t>>;
+    timeSort("idSort std::sort", ids, [](IdPairs &pairs) { std::sort(pairs.begin(), pairs.end()); });
+    timeSort("idSort radix", ids, [](IdPairs &pairs) { ParallelSort::sort(pairs); });
+    timeSort("balanceSort std::sort", balances, [](BalancePairs &pairs) { std::sort(pairs.begin(), pairs.end()); });
+    timeSort("balanceSort radix", balances, [](BalancePairs &pairs) { ParallelSort::sort(pairs); });
+    timeSort("nameSort std::sort", byName, [](NamePairs &pairs) { std::sort(pairs.begin(), pairs.end()); });
+    timeSort("nameSort merge 4 threads", byName, [](NamePairs &pairs) { ParallelSort::sort(pairs, 4); });
+    timeSort("nameSort merge all cores", byName, [](NamePairs &pairs) { ParallelSort::sort(pairs); });
+}
+
+/**
+ * Compares loading a CSV file through bulkLoad with adding the same accounts one
+ * addAccount call at a time.
+ */
+void benchBulkLoad(int count) {
+    const std::string path = "/tmp/bankbench_accounts.csv";
+    // CSV ids have exactly seven digits, so a file holds at most 9,000,000 accounts.
+    count = std::min(count, 10000000 - Workload::FIRST_ID);
+    {
+        std::ofstream file(path);
+        file << "id,name,balance\n";
+        for (int i = 0; i < count; ++i) {
+            file << Workload::FIRST_ID + i << ",Holder " << i << "," << syntheticBalance(i) << "\n";
+        }
+    }
+
+    Stopwatch start;
+    Bank loaded;
+    std::size_t added = loaded.bulkLoad(path);
+    report("bulkLoad", count, added, sampleSince(start));
+
+    start = Stopwatch();
+    Bank oneByOne;
+    populate(oneByOne, count);
+    report("addAccount loop", count, count, sampleSince(start));
+    std::remove(path.c_str());
+}
+
+/**
+ * Times saving a bank to a snapshot, opening the snapshot in a new bank, and
+ * serving random findAccount calls from it, each of which loads one account.
+ */
+void benchSnapshot(int count) {
+    const std::string path = "/tmp/bankbench_accounts.snap";
+    {
+        Bank bank;
+        populate(bank, count);
+        Stopwatch start;
+        bank.saveSnapshot(path);
+        report("saveSnapshot", count, count, sampleSince(start));
+    }
+
+    Bank bank;
+    Stopwatch start;
+    bank.openSnapshot(path);
+    long long found = bank.findAccount(Workload::FIRST_ID + count / 2) != nullptr;
+    report("openSnapshot+first find", count, 1, sampleSince(start));
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(Workload::FIRST_ID, Workload::FIRST_ID + count - 1);
+    std::vector<int> ids(LOOKUPS);
+    for (auto &id : ids) id = pick(rng);
+    start = Stopwatch();
+    for (int id : ids) {
+        found += bank.findAccount(id) != nullptr;
+    }
+    report("findAccount from snapshot", count, LOOKUPS, sampleSince(start));
+
+    start = Stopwatch();
+    Money total;
+    found += bank.totalBalance(total) && total > Money();
+    report("load rest of snapshot", count, count, sampleSince(start));
+    sink = found;
+    std::remove(path.c_str());
+}
+
+/**
+ * Times durable commits through the write-ahead log with several concurrent
+ * writers, and reports how many commits each fsync carried on average.
+ * @param writers The number of writer threads.
+ * @param commitsPerWriter The number of records each writer commits.
+ */
+void benchGroupCommit(int writers, int commitsPerWriter) {
+    const std::string path = "/tmp/bankbench.wal";
+    std::remove(path.c_str());
+    WriteAheadLog log;
+    log.open(path, 0, [](const LogRecord&) {});
+
+    Stopwatch start;
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&log, w, commitsPerWriter] {
+            for (int i = 0; i < commitsPerWriter; ++i) {
+                log.commit({LogOp::Deposit, Workload::FIRST_ID + w, Money(1, 0), {}});
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    Sample sample = sampleSince(start);
+    long long commits = (long long)writers * commitsPerWriter;
+    report("commit " + std::to_string(writers) + " writers", writers, commits, sample);
+    notes() << std::setw(40) << std::setprecision(1) << double(commits) / log.syncCount()
+              << " commits/fsync\n";
+    log.close();
+    std::remove(path.c_str());
+}
+
+/**
+ * Times deposits through a bank whose write-ahead log is open, so every deposit
+ * waits for its own fsync, then recovery of the bank from its log.
+ */
+void benchDurableDeposit(int count) {
+    const std::string path = "/tmp/bankbench_deposits.wal";
+    std::remove(path.c_str());
+    const int deposits = 1000;
+    {
+        Bank bank;
+        populate(bank, count);
+        bank.openLog(path);
+        Stopwatch start;
+        for (int i = 0; i < deposits; ++i) {
+            bank.deposit(Workload::FIRST_ID + i % count, Money(1, 0));
+        }
+        report("deposit durable", count, deposits, sampleSince(start));
+    }
+    Bank recovered;
+    populate(recovered, count);
+    Stopwatch start;
+    recovered.openLog(path);
+    report("replay log", count, deposits, sampleSince(start));
+    std::remove(path.c_str());
+}
+
+/**
+ * Compares a full checkpoint with an incremental one after deposits to 1% of the
+ * accounts, then times merging the resulting delta into the base snapshot.
+ */
+void benchCheckpoint(int count) {
+    const std::string path = "/tmp/bankbench_checkpoint.snap";
+    const std::string logPath = path + ".wal";
+    std::remove(logPath.c_str());
+    Bank bank;
+    populate(bank, count);
+    bank.openLog(logPath);
+
+    Stopwatch start;
+    bank.checkpoint(path); // The first checkpoint writes the whole bank.
+    report("checkpoint full", count, count, sampleSince(start));
+
+    int changed = std::max(1, count / 100);
+    for (int i = 0; i < changed; ++i) {
+        bank.deposit(Workload::FIRST_ID + (int)((long long)i * 97 % count), Money(1, 0));
+    }
+    start = Stopwatch();
+    bank.checkpoint(path);
+    report("checkpoint delta 1%", count, changed, sampleSince(start));
+
+    start = Stopwatch();
+    SnapshotMerger::merge(path);
+    report("merge delta", count, count, sampleSince(start));
+    std::remove(path.c_str());
+    std::remove(logPath.c_str());
+}
+
+/**
+ * Times taking a point-in-time view of the bank, then deposits with and without a
+ * report thread that keeps taking views and totalling them at the same time.
+ */
+void benchReportView(int count) {
+    Bank bank;
+    populate(bank, count);
+    const int views = 100000;
+    Stopwatch start;
+    for (int i = 0; i < views; ++i) {
+        AccountColumns::View view = bank.view();
+        sink = view.size();
+    }
+    report("view", count, views, sampleSince(start));
+
+    const int deposits = 1000000;
+    start = Stopwatch();
+    for (int i = 0; i < deposits; ++i) {
+        bank.deposit(Workload::FIRST_ID + i % count, Money(0, 1));
+    }
+    report("deposit", count, deposits, sampleSince(start));
+
+    std::atomic<bool> done{false};
+    long long reports = 0;
+    std::thread reader([&] {
+        while (!done) {
+            Money total;
+            bank.view().totalBalance(total);
+            sink = total.minorUnits();
+            ++reports;
+        }
+    });
+    start = Stopwatch();
+    for (int i = 0; i < deposits; ++i) {
+        bank.deposit(Workload::FIRST_ID + i % count, Money(0, 1));
+    }
+    report("deposit during reports", count, deposits, sampleSince(start));
+    done = true;
+    reader.join();
+    notes() << std::setw(40) << reports << " reports completed\n";
+}
+
+/**
+ * Times deposits and withdrawals from several threads at once, each thread on its
+ * own accounts, so the only shared state is the table lock and the balance stripes.
+ * @param threadCount The number of threads updating balances.
+ * @param count The number of accounts in the bank.
+ */
+void benchStripedScaling(int threadCount, int count) {
+    Bank bank;
+    populate(bank, count);
+    const int opsPerThread = 1000000 / threadCount;
+    Stopwatch start;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&bank, t, threadCount, count, opsPerThread] {
+            // Thread t owns every account whose index is t modulo the thread count.
+            std::vector<AccountHandle> handles;
+            for (int i = t; i < count; i += threadCount) handles.push_back(bank.findHandle(Workload::FIRST_ID + i));
+            for (int i = 0; i < opsPerThread; ++i) {
+                AccountHandle handle = handles[i % handles.size()];
+                if (i & 1) bank.withdraw(handle, Money(0, 1));
+                else bank.deposit(handle, Money(0, 1));
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    report("deposit/withdraw " + std::to_string(threadCount) + " threads", count,
+           (long long)opsPerThread * threadCount, sampleSince(start));
+}
+
+/**
+ * Times deposits and withdrawals from several threads on one hot account, under each
+ * way the bank can serialize balance updates.
+ * @param mode How the bank serializes balance updates.
+ * @param modeName The name printed for the mode.
+ * @param threadCount The number of threads updating the account.
+ */
+void benchHotAccount(Bank::ConcurrencyMode mode, const std::string &modeName, int threadCount) {
+    Bank bank(mode);
+    bank.addAccount(Account(Workload::FIRST_ID, Money(1000000, 0), "Merchant"));
+    AccountHandle hot = bank.findHandle(Workload::FIRST_ID);
+    const int opsPerThread = 1000000 / threadCount;
+    Stopwatch start;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&bank, hot, opsPerThread] {
+            for (int i = 0; i < opsPerThread; ++i) {
+                if (i & 1) bank.withdraw(hot, Money(0, 1));
+                else bank.deposit(hot, Money(0, 1));
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    report("hot " + modeName + " " + std::to_string(threadCount) + " threads", 1,
+           (long long)opsPerThread * threadCount, sampleSince(start));
+}
+
+/**
+ * Times transfers between accounts drawn from a workload, from several threads, one
+ * call per transfer and then in batches.
+ * @param count The number of accounts in the bank.
+ * @param skew The Zipf exponent of the workload, or 0 for a uniform one.
+ * @param threadCount The number of threads making transfers.
+ */
+void benchTransfers(int count, double skew, int threadCount) {
+    Bank bank;
+    populate(bank, count);
+    const int transfersPerThread = 1000000 / threadCount;
+    const std::size_t batchSize = 256;
+    std::string workload = skew == 0 ? "uniform" : "zipf";
+    for (bool batched : {false, true}) {
+        Stopwatch start;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&bank, t, count, skew, batched, transfersPerThread, batchSize] {
+                Workload accounts(count, skew, t + 1);
+                std::vector<Transfer> batch;
+                std::vector<bool> succeeded;
+                for (int i = 0; i < transfersPerThread; ++i) {
+                    auto [from, to] = accounts.nextPair();
+                    if (!batched) {
+                        bank.transfer(Workload::FIRST_ID + static_cast<int>(from), Workload::FIRST_ID + static_cast<int>(to), Money(0, 1));
+                        continue;
+                    }
+                    batch.push_back({Workload::FIRST_ID + static_cast<int>(from), Workload::FIRST_ID + static_cast<int>(to), Money(0, 1)});
+                    if (batch.size() == batchSize || i + 1 == transfersPerThread) {
+                        bank.transfer(batch, succeeded);
+                        batch.clear();
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        report("transfer " + workload + (batched ? " batched" : ""), count,
+               (long long)transfersPerThread * threadCount, sampleSince(start));
+    }
+}
+
+/**
+ * Applies the same stream of random deposits and withdrawals one call at a time and
+ * through applyBatch() in batches of growing size, checking that both end with the
+ * same total balance.
+ */
+void benchApplyBatch(int count) {
+    const int updates = 1000000;
+    std::vector<BalanceUpdate> stream;
+    stream.reserve(updates);
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    for (int i = 0; i < updates; ++i) {
+        BalanceUpdate::Op op = i % 2 == 0 ? BalanceUpdate::Op::Deposit : BalanceUpdate::Op::Withdraw;
+        stream.push_back({Workload::FIRST_ID + pick(random), op, Money(0, 10)});
+    }
+
+    Money expected;
+    {
+        Bank single;
+        populate(single, count);
+        Stopwatch start;
+        for (const BalanceUpdate &update : stream) {
+            if (update.op == BalanceUpdate::Op::Deposit) single.deposit(update.id, update.amount);
+            else single.withdraw(update.id, update.amount);
+        }
+        report("update one at a time", count, updates, sampleSince(start));
+        single.totalBalance(expected);
+    }
+
+    for (std::size_t batchSize : {std::size_t(256), std::size_t(65536), std::size_t(updates)}) {
+        Bank batched;
+        populate(batched, count);
+        std::vector<BalanceUpdate> batch;
+        std::vector<UpdateResult> results;
+        Stopwatch start;
+        for (std::size_t first = 0; first < stream.size(); first += batchSize) {
+            batch.assign(stream.begin() + first, stream.begin() + std::min(stream.size(), first + batchSize));
+            batched.applyBatch(batch, results);
+        }
+        report("applyBatch " + std::to_string(batchSize), count, updates, sampleSince(start));
+        Money total;
+        if (!batched.totalBalance(total) || total != expected) notes() << "applyBatch changed the total balance\n";
+    }
+}
+
+/**
+ * Times balance reads from many threads while one thread keeps updating the same
+ * accounts, first through getAccount(), which shares the table lock with every
+ * update, then through the lock-free checkBalance().
+ * @param readerCount The number of threads reading balances.
+ * @param count The number of accounts read and updated; 1 makes one hot account.
+ */
+void benchBalanceReads(int readerCount, int count) {
+    Bank bank;
+    populate(bank, count);
+    std::vector<AccountHandle> handles;
+    for (int i = 0; i < count; ++i) handles.push_back(bank.findHandle(Workload::FIRST_ID + i));
+    const int readsPerThread = 3000000 / readerCount;
+    for (bool lockFree : {false, true}) {
+        std::atomic<bool> done{false};
+        std::atomic<long long> writes{0};
+        std::thread writer([&bank, &handles, &done, &writes] {
+            long long i = 0;
+            for (; !done.load(std::memory_order_relaxed); ++i) {
+                AccountHandle handle = handles[i % handles.size()];
+                if (i & 1) bank.withdraw(handle, Money(0, 1));
+                else bank.deposit(handle, Money(0, 1));
+            }
+            writes = i;
+        });
+        Stopwatch start;
+        std::vector<std::thread> readers;
+        for (int t = 0; t < readerCount; ++t) {
+            readers.emplace_back([&bank, &handles, t, lockFree, readsPerThread] {
+                long long total = 0;
+                for (int i = 0; i < readsPerThread; ++i) {
+                    AccountHandle handle = handles[(i + t) % handles.size()];
+                    Money balance;
+                    if (lockFree) bank.checkBalance(handle, balance);
+                    else balance = bank.getAccount(handle)->getBalance();
+                    total += balance.minorUnits();
+                }
+                sink = total;
+            });
+        }
+        for (auto &reader : readers) reader.join();
+        Sample sample = sampleSince(start);
+        done = true;
+        writer.join();
+        std::string setup = (lockFree ? " lock-free " : " locked ") + std::to_string(readerCount) + "r+1w";
+        report("read" + setup, count, (long long)readsPerThread * readerCount, sample);
+        report("write" + setup, count, writes, sample);
+    }
+}
+
+/**
+ * Times deposits and withdrawals on a sharded bank from several client threads,
+ * each keeping a window of requests in flight, then cross-shard transfers.
+ * @param shardCount The number of shards.
+ * @param clients The number of client threads.
+ * @param count The number of accounts in the bank.
+ */
+void benchSharded(int shardCount, int clients, int count) {
+    ShardedBank bank(shardCount);
+    for (int i = 0; i < count; ++i) {
+        bank.addAccount(Account(Workload::FIRST_ID + i, syntheticBalance(i), "Holder " + std::to_string(i)));
+    }
+    const int opsPerClient = 1000000 / clients;
+    const int window = 64;
+    for (ShardedBank::Op op : {ShardedBank::Op::Deposit, ShardedBank::Op::Transfer}) {
+        Stopwatch start;
+        std::vector<std::thread> threads;
+        for (int c = 0; c < clients; ++c) {
+            threads.emplace_back([&bank, c, op, count, opsPerClient, window] {
+                std::vector<ShardedBank::Request> requests(window);
+                Workload accounts(count, 0, c + 1);
+                for (int i = 0; i < opsPerClient; i += window) {
+                    for (int r = 0; r < window; ++r) {
+                        ShardedBank::Request &request = requests[r];
+                        auto [from, to] = accounts.nextPair();
+                        request.op = op == ShardedBank::Op::Deposit && (r & 1) ? ShardedBank::Op::Withdraw : op;
+                        request.id = Workload::FIRST_ID + static_cast<int>(from);
+                        request.target = Workload::FIRST_ID + static_cast<int>(to);
+                        request.amount = Money(0, 1);
+                        bank.submit(request);
+                    }
+                    for (const auto &request : requests) ShardedBank::wait(request);
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        std::string name = op == ShardedBank::Op::Deposit ? "sharded dep/wd " : "sharded transfer ";
+        report(name + std::to_string(shardCount) + "x" + std::to_string(clients), count,
+               (long long)(opsPerClient / window * window) * clients, sampleSince(start));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long long maxAccounts = 10000000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--json") jsonOutput = true;
+        else maxAccounts = std::stoll(argv[i]);
+    }
+    for (int writers : {1, 8, 64}) {
+        benchGroupCommit(writers, 500);
+    }
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        benchStripedScaling(threads, 100000);
+    }
+    for (int shards : {1, 2, 4, 8}) {
+        benchSharded(shards, 4, 100000);
+    }
+    for (int threads : {1, 8, 32}) {
+        benchHotAccount(Bank::ConcurrencyMode::Mutex, "mutex", threads);
+        benchHotAccount(Bank::ConcurrencyMode::Striped, "striped", threads);
+        benchHotAccount(Bank::ConcurrencyMode::LockFree, "lock-free", threads);
+    }
+    for (int count : {1, 100000}) {
+        benchBalanceReads(31, count);
+    }
+    for (int sessions : {1000, 10000, 100000}) {
+        benchMenuSessions(sessions, 3);
+    }
+    for (long long count : {1000LL, 100000LL, 1000000LL, 10000000LL}) {
+        if (count > maxAccounts) break;
+        benchFindAccount(static_cast<int>(count));
+        benchBalanceScan(static_cast<int>(count));
+        benchMoneySum(static_cast<int>(count));
+        benchNameSearch(static_cast<int>(count));
+        benchBalanceRange(static_cast<int>(count));
+        benchDeleteAccount(static_cast<int>(count));
+        benchSortsAndReports(static_cast<int>(count));
+        benchNameSort(static_cast<int>(count));
+        benchIndexSorts(static_cast<int>(count));
+        benchBulkLoad(static_cast<int>(count));
+        benchSnapshot(static_cast<int>(count));
+        benchDurableDeposit(static_cast<int>(count));
+        benchCheckpoint(static_cast<int>(count));
+        benchReportView(static_cast<int>(count));
+        benchApplyBatch(static_cast<int>(count));
+        benchTransfers(static_cast<int>(count), 0, 4);
+        benchTransfers(static_cast<int>(count), 0.99, 4);
+    }
+    if (jsonOutput) std::cout << "\n]\n";
+    return 0;
+}
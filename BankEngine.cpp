@@ -0,0 +1,17 @@
+// Unity build of the Bank engine: every module up to Bank, in dependency order.
+// Each program includes this file once, then the modules it adds on top.
+#include "Money.cpp"
+#include "NamePool.cpp"
+#include "Account.cpp"
+#include "AccountStore.cpp"
+#include "AccountColumns.cpp"
+#include "NameIndex.cpp"
+#include "ParallelSort.cpp"
+#include "BalanceIndex.cpp"
+#include "SortedViews.cpp"
+#include "AccountCsv.cpp"
+#include "Snapshot.cpp"
+#include "WriteAheadLog.cpp"
+#include "SnapshotMerger.cpp"
+#include "Workload.cpp"
+#include "Bank.cpp"
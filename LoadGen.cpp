@@ -0,0 +1,379 @@
+#include <iostream>
+#include <memory>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BankEngine.cpp"
+
+// Load generator for the Bank engine: drives one bank from several threads with a
+// traffic mix and reports the throughput and latency percentiles of each operation
+// type. Build with
+//   g++ -std=c++20 -O2 -pthread LoadGen.cpp -o LoadGen
+// Synthetic mix, mostly balance checks, with Zipf-skewed account popularity:
+//   ./LoadGen --accounts 1000000 --threads 8 --ops 2000000 --skew 0.99 --mix 90,4,4,1,1
+// Fixed rate (each thread paces itself, latency is the service time) or open loop
+// (latency counts from when the operation was due, so a stall shows up as queueing):
+//   ./LoadGen --threads 8 --rate 200000
+//   ./LoadGen --threads 8 --rate 200000 --open-loop
+// Record the generated operations, or replay a recorded file, one operation a line:
+//   BAL <id> | DEP <id> <amount> | WD <id> <amount> | ADD <id> <amount> [name] | DEL <id>
+//   ./LoadGen --ops 100000 --record ops.txt
+//   ./LoadGen --replay ops.txt --threads 4
+// Run against accounts loaded from a CSV file or a snapshot instead of synthetic ones:
+//   ./LoadGen --load accounts.csv --threads 4
+//   ./LoadGen --load bank.snap --threads 4
+
+using Clock = std::chrono::steady_clock;
+
+// The kinds of operation in a mix, in the order of the --mix weights.
+enum class OpType { Check, Deposit, Withdraw, Add, Delete };
+const int OP_TYPES = 5;
+
+// Request words of the operation types in recorded files, as the ATM server spells them.
+const char *const OP_WORDS[OP_TYPES] = {"BAL", "DEP", "WD", "ADD", "DEL"};
+
+// One operation of the load.
+struct LoadOp {
+    OpType type;
+    int id;             // Account the operation works on
+    Money amount;       // Amount deposited, withdrawn or opened with
+    std::string name;   // Holder of an added account
+};
+
+// What a run is configured to do.
+struct LoadOptions {
+    std::size_t accounts = 100000;          // Synthetic accounts created before the run
+    int threads = 4;                        // Threads driving the bank
+    std::size_t ops = 1000000;              // Operations generated, over every thread
+    double skew = 0.99;                     // Zipf exponent of account popularity; 0 for uniform
+    int mix[OP_TYPES] = {90, 4, 4, 1, 1};   // Relative weights of the operation types
+    double rate = 0;                        // Operations per second over every thread; 0 for as fast as possible
+    bool openLoop = false;                  // Measure latency from when an operation was due
+    std::uint64_t seed = 1;                 // Seed of the synthetic mix
+    std::string replay;                     // File to replay instead of a synthetic mix
+    std::string record;                     // File to write the operations to
+    std::string load;                       // CSV file or snapshot to load instead of synthetic accounts
+};
+
+// Latencies measured by one thread, in nanoseconds, by operation type.
+struct LoadResult {
+    std::vector<std::uint64_t> latencies[OP_TYPES];
+    long long failures[OP_TYPES] = {};      // Operations the bank refused
+};
+
+/**
+ * Generates the synthetic operations of each thread. Account popularity follows the
+ * workload's Zipf skew; added accounts get fresh ids and each thread later deletes
+ * the accounts it added itself, oldest first, so churn never removes a hot account.
+ * @param options The mix, skew, seed and counts to generate.
+ * @param ids The ids of the bank's accounts, most popular first.
+ * @return The operations of each thread, in the order the thread runs them.
+ */
+std::vector<std::vector<LoadOp>> generate(const LoadOptions &options, const std::vector<int> &ids) {
+    std::vector<std::vector<LoadOp>> perThread(options.threads);
+    std::size_t opsPerThread = options.ops / options.threads;
+    int totalWeight = 0;
+    for (int weight : options.mix) totalWeight += weight;
+    for (int t = 0; t < options.threads; ++t) {
+        Workload accounts(ids.size(), options.skew, options.seed + t);
+        std::mt19937_64 random(options.seed * 7919 + t);
+        std::uniform_int_distribution<int> pickType(0, totalWeight - 1);
+        std::deque<int> added; // Accounts this thread added and has not deleted yet
+        int nextId = *std::max_element(ids.begin(), ids.end()) + 1 + t * static_cast<int>(opsPerThread);
+        std::vector<LoadOp> &ops = perThread[t];
+        ops.reserve(opsPerThread);
+        for (std::size_t i = 0; i < opsPerThread; ++i) {
+            int draw = pickType(random);
+            int type = 0;
+            while (draw >= options.mix[type]) draw -= options.mix[type++];
+            LoadOp op{static_cast<OpType>(type), 0, Money(), {}};
+            if (op.type == OpType::Delete && added.empty()) op.type = OpType::Add;
+            switch (op.type) {
+                case OpType::Add:
+                    op.id = nextId++;
+                    op.amount = Money(100, 0);
+                    op.name = "Load Holder " + std::to_string(op.id);
+                    added.push_back(op.id);
+                    break;
+                case OpType::Delete:
+                    op.id = added.front();
+                    added.pop_front();
+                    break;
+                default:
+                    op.id = ids[accounts.nextAccount()];
+                    op.amount = Money(1, 0);
+            }
+            ops.push_back(std::move(op));
+        }
+    }
+    return perThread;
+}
+
+/**
+ * Reads a recorded operation file and deals its operations out to the threads
+ * round-robin. Lines that do not parse are skipped and counted.
+ * @param path The file to read.
+ * @param threads The number of threads.
+ * @param perThread Receives the operations of each thread.
+ * @return false if the file cannot be opened.
+ */
+bool readReplay(const std::string &path, int threads, std::vector<std::vector<LoadOp>> &perThread) {
+    std::ifstream file(path);
+    if (!file) return false;
+    perThread.assign(threads, {});
+    std::string line, word, amount;
+    std::size_t next = 0, skipped = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        LoadOp op{OpType::Check, 0, Money(), {}};
+        if (!(fields >> word >> op.id)) {
+            ++skipped;
+            continue;
+        }
+        int type = 0;
+        while (type < OP_TYPES && word != OP_WORDS[type]) ++type;
+        op.type = static_cast<OpType>(type);
+        bool valid = type < OP_TYPES;
+        if (valid && (op.type == OpType::Deposit || op.type == OpType::Withdraw || op.type == OpType::Add)) {
+            valid = fields >> amount && Money::parse(amount, op.amount);
+        }
+        if (valid && op.type == OpType::Add) {
+            std::getline(fields >> std::ws, op.name);
+        }
+        if (!valid) {
+            ++skipped;
+            continue;
+        }
+        perThread[next++ % threads].push_back(std::move(op));
+    }
+    if (skipped > 0) std::cerr << "Skipped " << skipped << " lines of " << path << " that do not parse\n";
+    return true;
+}
+
+/**
+ * Writes operations to a file in the replay format, interleaving the threads
+ * round-robin so that replaying with the same thread count gives each thread the
+ * same operations.
+ * @return false if the file cannot be written.
+ */
+bool writeRecord(const std::string &path, const std::vector<std::vector<LoadOp>> &perThread) {
+    std::ofstream file(path);
+    if (!file) return false;
+    std::size_t longest = 0;
+    for (const auto &ops : perThread) longest = std::max(longest, ops.size());
+    for (std::size_t i = 0; i < longest; ++i) {
+        for (const auto &ops : perThread) {
+            if (i >= ops.size()) continue;
+            const LoadOp &op = ops[i];
+            file << OP_WORDS[static_cast<int>(op.type)] << ' ' << op.id;
+            if (op.type != OpType::Check && op.type != OpType::Delete) file << ' ' << op.amount;
+            if (op.type == OpType::Add) file << ' ' << op.name;
+            file << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * Runs one operation against the bank.
+ * @return true if the bank carried it out, false if it refused it.
+ */
+bool execute(Bank &bank, const LoadOp &op) {
+    Money balance;
+    switch (op.type) {
+        case OpType::Check: return bank.checkBalance(bank.findHandle(op.id), balance);
+        case OpType::Deposit: return bank.deposit(op.id, op.amount);
+        case OpType::Withdraw: return bank.withdraw(op.id, op.amount);
+        case OpType::Add: return bank.addAccount(Account(op.id, op.amount, op.name));
+        case OpType::Delete: return bank.deleteAccount(op.id);
+    }
+    return false;
+}
+
+/**
+ * Runs a thread's operations, paced to a rate if one is given, and records the
+ * latency of each.
+ * @param bank The bank to drive.
+ * @param ops The operations of this thread.
+ * @param rate The operations per second of this thread, or 0 for as fast as possible.
+ * @param openLoop Whether latency counts from when the operation was due rather than from when it started.
+ * @param start When the run started, the origin of the pacing schedule.
+ * @param result Receives the latencies and failures.
+ */
+void drive(Bank &bank, const std::vector<LoadOp> &ops, double rate, bool openLoop, Clock::time_point start, LoadResult &result) {
+    for (auto &latencies : result.latencies) latencies.reserve(ops.size() / 8);
+    for (std::size_t i = 0; i < ops.size(); ++i) {
+        Clock::time_point due = start;
+        if (rate > 0) {
+            due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / rate));
+            // A late operation starts at once; in an open loop its lateness counts as latency.
+            std::this_thread::sleep_until(due);
+        }
+        Clock::time_point begin = Clock::now();
+        bool done = execute(bank, ops[i]);
+        Clock::time_point end = Clock::now();
+        int type = static_cast<int>(ops[i].type);
+        Clock::time_point from = rate > 0 && openLoop ? due : begin;
+        result.latencies[type].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - from).count());
+        if (!done) ++result.failures[type];
+    }
+}
+
+/**
+ * Returns a percentile of sorted latencies, in microseconds.
+ * @param sorted Latencies in nanoseconds, ascending; not empty.
+ * @param percentile The percentile, between 0 and 100.
+ */
+double percentileMicros(const std::vector<std::uint64_t> &sorted, double percentile) {
+    std::size_t rank = static_cast<std::size_t>(percentile / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[rank] / 1000.0;
+}
+
+/**
+ * Merges the threads' latencies and prints throughput and percentiles by operation type.
+ */
+void printResults(std::vector<LoadResult> &results, double seconds) {
+    static const char *const names[OP_TYPES] = {"checkBalance", "deposit", "withdraw", "addAccount", "deleteAccount"};
+    std::cout << std::left << std::setw(16) << "operation" << std::right << std::setw(10) << "count"
+              << std::setw(12) << "ops/s" << std::setw(10) << "failed" << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us" << "\n";
+    std::vector<std::uint64_t> all;
+    long long allFailures = 0;
+    auto printRow = [seconds](const std::string &name, std::vector<std::uint64_t> &latencies, long long failures) {
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::left << std::setw(16) << name << std::right << std::setw(10) << latencies.size()
+                  << std::setw(12) << std::fixed << std::setprecision(0) << latencies.size() / seconds
+                  << std::setw(10) << failures << std::setprecision(2)
+                  << std::setw(12) << percentileMicros(latencies, 50)
+                  << std::setw(12) << percentileMicros(latencies, 99)
+                  << std::setw(12) << percentileMicros(latencies, 99.9) << "\n";
+    };
+    for (int type = 0; type < OP_TYPES; ++type) {
+        std::vector<std::uint64_t> latencies;
+        long long failures = 0;
+        for (LoadResult &result : results) {
+            latencies.insert(latencies.end(), result.latencies[type].begin(), result.latencies[type].end());
+            failures += result.failures[type];
+        }
+        if (latencies.empty()) continue;
+        all.insert(all.end(), latencies.begin(), latencies.end());
+        allFailures += failures;
+        printRow(names[type], latencies, failures);
+    }
+    if (!all.empty()) printRow("all", all, allFailures);
+}
+
+/**
+ * Parses the --mix weights, e.g. "90,4,4,1,1" for checks, deposits, withdrawals, adds and deletes.
+ * @return true if there are five non-negative weights and at least one is positive.
+ */
+bool parseMix(const std::string &text, int mix[OP_TYPES]) {
+    std::istringstream fields(text);
+    std::string field;
+    int total = 0;
+    for (int type = 0; type < OP_TYPES; ++type) {
+        if (!std::getline(fields, field, ',')) return false;
+        mix[type] = std::atoi(field.c_str());
+        if (mix[type] < 0) return false;
+        total += mix[type];
+    }
+    return total > 0;
+}
+
+int main(int argc, char *argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--open-loop") {
+            options.openLoop = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << "\n";
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (option == "--accounts") options.accounts = std::stoull(value);
+        else if (option == "--threads") options.threads = std::max(1, std::stoi(value));
+        else if (option == "--ops") options.ops = std::stoull(value);
+        else if (option == "--skew") options.skew = std::stod(value);
+        else if (option == "--rate") options.rate = std::stod(value);
+        else if (option == "--seed") options.seed = std::stoull(value);
+        else if (option == "--replay") options.replay = value;
+        else if (option == "--record") options.record = value;
+        else if (option == "--load") options.load = value;
+        else if (option != "--mix" || !parseMix(value, options.mix)) {
+            std::cerr << "Usage: " << argv[0] << " [--accounts N] [--threads N] [--ops N] [--skew S]"
+                      << " [--mix check,deposit,withdraw,add,delete] [--rate R] [--open-loop]"
+                      << " [--seed N] [--replay FILE] [--record FILE] [--load FILE.csv|FILE.snap]\n";
+            return 2;
+        }
+    }
+    if (options.accounts == 0) options.accounts = 1;
+
+    Bank bank;
+    if (!options.load.empty()) {
+        bool snapshot = options.load.size() >= 5 && options.load.compare(options.load.size() - 5, 5, ".snap") == 0;
+        bool loaded = snapshot ? bank.openSnapshot(options.load) : bank.bulkLoad(options.load) > 0;
+        if (!loaded) {
+            std::cerr << "Could not load " << options.load << "\n";
+            return 1;
+        }
+    } else {
+        for (std::size_t i = 0; i < options.accounts; ++i) {
+            bank.addAccount(Account(Workload::FIRST_ID + static_cast<int>(i), Money(1000, 0), "Holder " + std::to_string(i)));
+        }
+    }
+    // Listing the ids also loads every account of a snapshot, before the clock starts.
+    std::vector<int> ids;
+    AccountColumns::View accounts = bank.view();
+    for (std::size_t slot = 0; slot < accounts.size(); ++slot) {
+        if (accounts.isLive(slot)) ids.push_back(accounts.id(slot));
+    }
+    if (ids.empty()) {
+        std::cerr << options.load << " holds no accounts\n";
+        return 1;
+    }
+    options.accounts = ids.size();
+
+    std::vector<std::vector<LoadOp>> perThread;
+    if (!options.replay.empty()) {
+        if (!readReplay(options.replay, options.threads, perThread)) {
+            std::cerr << "Could not read " << options.replay << "\n";
+            return 1;
+        }
+    } else {
+        perThread = generate(options, ids);
+    }
+    if (!options.record.empty() && !writeRecord(options.record, perThread)) {
+        std::cerr << "Could not write " << options.record << "\n";
+        return 1;
+    }
+
+    std::vector<LoadResult> results(options.threads);
+    std::vector<std::thread> threads;
+    double threadRate = options.rate / options.threads;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < options.threads; ++t) {
+        threads.emplace_back(drive, std::ref(bank), std::cref(perThread[t]), threadRate, options.openLoop, start, std::ref(results[t]));
+    }
+    for (auto &thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << options.threads << " threads, " << options.accounts << " accounts, "
+              << (options.rate > 0 ? (options.openLoop ? "open loop at " : "fixed rate of ") + std::to_string(static_cast<long long>(options.rate)) + " ops/s"
+                                   : std::string("as fast as possible"))
+              << ", " << std::fixed << std::setprecision(2) << seconds << " s\n";
+    printResults(results, seconds);
+    return 0;
+}
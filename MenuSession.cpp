@@ -0,0 +1,67 @@
+#include <utility>
+#include "MenuSession.h"
+
+MenuSession::Task& MenuSession::Task::operator=(Task &&other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+MenuSession::Task::~Task() {
+    // Destroying a flow also destroys the flows it was awaiting, held in its frame.
+    if (handle) handle.destroy();
+}
+
+std::optional<std::string> MenuSession::LineAwaiter::await_resume() {
+    if (!session.hasLine) return std::nullopt;
+    session.hasLine = false;
+    return std::move(session.line);
+}
+
+void MenuSession::CommitAwaiter::await_suspend(std::coroutine_handle<> waiter) noexcept {
+    session.waiting = waiter;
+    session.commitSequence = sequence;
+}
+
+void MenuSession::start(Task started) {
+    flow = std::move(started);
+    flow.handle.resume();
+}
+
+void MenuSession::deliver(std::string input) {
+    if (!waiting || commitSequence != 0) return;
+    line = std::move(input);
+    hasLine = true;
+    resumeWaiting();
+}
+
+void MenuSession::closeInput() {
+    closed = true;
+    if (commitSequence == 0) resumeWaiting(); // Otherwise the flow sees it once committed.
+}
+
+void MenuSession::committed() {
+    if (commitSequence == 0) return;
+    commitSequence = 0;
+    resumeWaiting();
+}
+
+bool MenuSession::finished() const {
+    return !flow.handle || flow.handle.done();
+}
+
+std::string MenuSession::takeOutput() {
+    std::string text = out.str();
+    out.str(std::string());
+    return text;
+}
+
+void MenuSession::resumeWaiting() {
+    std::coroutine_handle<> resumed = waiting;
+    if (!resumed) return;
+    waiting = nullptr; // The flow sets it again when it next waits.
+    resumed.resume();
+}
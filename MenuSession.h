@@ -0,0 +1,171 @@
+#ifndef MENU_SESSION_H
+#define MENU_SESSION_H
+
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+
+// The MenuSession class runs one user's menu flow as a C++20 coroutine instead of on
+// a thread of its own. The flow reads its input with
+//
+//   std::optional<std::string> line = co_await session.nextLine();
+//
+// which suspends it until the event loop driving the session calls deliver(), and
+// writes to output(), which the loop collects with takeOutput() and sends on. A
+// suspended session is a heap frame of a few hundred bytes, so one thread can keep
+// tens of thousands of them waiting for their users.
+//
+// A flow that changed the bank without waiting for the write-ahead log suspends in
+//
+//   co_await session.commit(sequence);
+//
+// until the loop, told by awaitedCommit() what to wait for, calls committed(), so
+// a commit in progress holds up only its own session, not the loop's thread.
+//
+// A session is driven by one thread at a time; different sessions may run on
+// different threads at once.
+class MenuSession {
+public:
+    // A menu flow, or a part of one, written as a coroutine. Flows start when first
+    // awaited (or given to start()), and a flow can co_await another to run it to the
+    // end, suspending as often as that one waits for input.
+    class Task {
+    public:
+        struct promise_type;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        // Resumes the awaiting flow once this one is done.
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(Handle done) noexcept {
+                std::coroutine_handle<> continuation = done.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        struct promise_type {
+            std::coroutine_handle<> continuation;   // The flow awaiting this one, if any
+
+            Task get_return_object() { return Task(Handle::from_promise(*this)); }
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const { throw; } // Reaches whoever resumed the session
+        };
+
+        Task(Task &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+        Task& operator=(Task &&other) noexcept;
+        ~Task();
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        // Awaiting a task runs it, then continues the awaiting flow.
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+            handle.promise().continuation = awaiter;
+            return handle;
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        friend class MenuSession;
+        explicit Task(Handle handle) : handle(handle) {}
+
+        Handle handle;  // Owns the coroutine frame
+    };
+
+    // Awaited to get the next line of input; see nextLine().
+    class LineAwaiter {
+    public:
+        explicit LineAwaiter(MenuSession &session) : session(session) {}
+        bool await_ready() const noexcept { return session.hasLine || session.closed; }
+        void await_suspend(std::coroutine_handle<> waiter) noexcept { session.waiting = waiter; }
+        std::optional<std::string> await_resume();
+
+    private:
+        MenuSession &session;
+    };
+
+    // Awaited to wait for a log commit; see commit().
+    class CommitAwaiter {
+    public:
+        CommitAwaiter(MenuSession &session, std::uint64_t sequence) : session(session), sequence(sequence) {}
+        bool await_ready() const noexcept { return sequence == 0; }
+        void await_suspend(std::coroutine_handle<> waiter) noexcept;
+        void await_resume() const noexcept {}
+
+    private:
+        MenuSession &session;
+        std::uint64_t sequence;     // The awaited log record
+    };
+
+    MenuSession() = default;
+    MenuSession(const MenuSession&) = delete;
+    MenuSession& operator=(const MenuSession&) = delete;
+
+    /**
+     * Starts a session's flow and runs it until it first waits for input.
+     * @param flow The flow; the session owns it from now on.
+    */
+    void start(Task flow);
+
+    /**
+     * Hands the flow its next line of input and runs it until it waits for another.
+     * Lines delivered while the flow is not waiting for one, or waits for a commit,
+     * are dropped.
+     * @param line The line, without the line break.
+    */
+    void deliver(std::string line);
+
+    // Tells the flow no more input will come; waiting for input then gets std::nullopt.
+    void closeInput();
+
+    /**
+     * Suspends the calling flow until a line of input arrives.
+     * @return An awaitable giving the line, or std::nullopt once the input is closed.
+    */
+    LineAwaiter nextLine() { return LineAwaiter(*this); }
+
+    /**
+     * Suspends the calling flow until the loop calls committed().
+     * @param sequence The log sequence number of a mutation made without waiting for
+     * the log, or 0 to go on at once.
+     * @return An awaitable that resumes once the record's commit is settled.
+    */
+    CommitAwaiter commit(std::uint64_t sequence) { return CommitAwaiter(*this, sequence); }
+
+    // Returns the log sequence number the flow waits for in commit(), or 0 if it does not.
+    std::uint64_t awaitedCommit() const { return commitSequence; }
+
+    // Resumes the flow waiting in commit() once its record's commit is settled.
+    void committed();
+
+    // Tells whether the input was closed.
+    bool inputClosed() const { return closed; }
+
+    // Tells whether the flow has run to its end.
+    bool finished() const;
+
+    // Returns the stream the flow writes its output to.
+    std::ostream& output() { return out; }
+
+    // Returns the output written since the last call and clears it.
+    std::string takeOutput();
+
+private:
+    // Helper function to resume the waiting flow, if any
+    void resumeWaiting();
+
+    Task flow{nullptr};                 // The outermost flow
+    std::coroutine_handle<> waiting;    // The innermost flow, suspended in nextLine() or commit()
+    std::uint64_t commitSequence = 0;   // The record the flow waits for in commit(), or 0
+    std::string line;                   // Input delivered but not yet taken by the flow
+    bool hasLine = false;               // Whether line holds input
+    bool closed = false;                // Set by closeInput()
+    std::ostringstream out;             // Output not yet taken
+};
+
+#endif // MENU_SESSION_H
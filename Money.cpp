@@ -0,0 +1,70 @@
+#include "Money.h"
+
+Money::Money() : minor(0) {}
+
+Money::Money(std::int64_t major, std::int64_t minorPart) : minor(major * MINOR_PER_MAJOR + minorPart) {}
+
+Money Money::fromMinorUnits(std::int64_t minorUnits) {
+    Money amount;
+    amount.minor = minorUnits;
+    return amount;
+}
+
+bool Money::parse(std::string_view text, Money &result) {
+    std::size_t pos = 0;
+    bool negative = pos < text.size() && text[pos] == '-';
+    if (negative) ++pos;
+
+    std::int64_t value = 0;
+    int digits = 0, fraction = -1; // fraction counts decimals once the point is seen
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '.' && fraction < 0) {
+            fraction = 0;
+            continue;
+        }
+        if (c < '0' || c > '9') return false;
+        if (fraction >= 0 && ++fraction > FRACTION_DIGITS) return false; // Sub-minor precision.
+        if (__builtin_mul_overflow(value, 10, &value) ||
+            __builtin_add_overflow(value, c - '0', &value)) return false;
+        ++digits;
+    }
+    if (digits == 0) return false;
+
+    // Scale the missing decimals, e.g. "12.5" was read as 125 and becomes 1250.
+    for (int i = fraction < 0 ? 0 : fraction; i < FRACTION_DIGITS; ++i) {
+        if (__builtin_mul_overflow(value, 10, &value)) return false;
+    }
+    result.minor = negative ? -value : value;
+    return true;
+}
+
+std::int64_t Money::minorUnits() const {
+    return minor;
+}
+
+bool Money::checkedAdd(Money other, Money &result) const {
+    std::int64_t sum;
+    if (__builtin_add_overflow(minor, other.minor, &sum)) return false;
+    result.minor = sum;
+    return true;
+}
+
+bool Money::checkedSub(Money other, Money &result) const {
+    std::int64_t difference;
+    if (__builtin_sub_overflow(minor, other.minor, &difference)) return false;
+    result.minor = difference;
+    return true;
+}
+
+std::string Money::toString() const {
+    // Work on the unsigned magnitude so that the most negative value formats too.
+    std::uint64_t magnitude = minor < 0 ? 0 - static_cast<std::uint64_t>(minor) : minor;
+    std::string fractionText = std::to_string(magnitude % MINOR_PER_MAJOR);
+    fractionText.insert(0, FRACTION_DIGITS - fractionText.size(), '0');
+    return (minor < 0 ? "-" : "") + std::to_string(magnitude / MINOR_PER_MAJOR) + "." + fractionText;
+}
+
+std::ostream& operator<<(std::ostream &os, Money amount) {
+    return os << amount.toString();
+}
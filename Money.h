@@ -0,0 +1,79 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// The Money class is a fixed-point amount stored as a whole number of minor units
+// (cents by default). All arithmetic is exact, and every operation that could
+// overflow is checked and reports failure instead of wrapping.
+class Money {
+public:
+    // Number of digits after the decimal point. Change both constants together to
+    // use another currency precision, e.g. 3 and 1000 for mills.
+    static const int FRACTION_DIGITS = 2;
+    static const std::int64_t MINOR_PER_MAJOR = 100;
+
+    // Creates a zero amount.
+    Money();
+
+    /**
+     * Creates an amount from major and minor units, e.g. Money(1040, 45) for 1040.45.
+     * @param major The whole currency units.
+     * @param minorPart The minor units, between 0 and MINOR_PER_MAJOR - 1.
+    */
+    Money(std::int64_t major, std::int64_t minorPart);
+
+    /**
+     * Creates an amount from a raw count of minor units.
+     * @param minorUnits The amount in minor units, e.g. 104045 for 1040.45.
+    */
+    static Money fromMinorUnits(std::int64_t minorUnits);
+
+    /**
+     * Parses a decimal amount such as "12", "12.5" or "-0.04".
+     * @param text The text to parse. It must contain nothing but the amount.
+     * @param result Receives the parsed amount on success.
+     * @return true if the text is a valid amount that fits, false otherwise.
+    */
+    static bool parse(std::string_view text, Money &result);
+
+    // Returns the amount in minor units.
+    std::int64_t minorUnits() const;
+
+    /**
+     * Adds two amounts with an overflow check.
+     * @param other The amount to add.
+     * @param result Receives the sum on success.
+     * @return true if the sum fits, false on overflow.
+    */
+    bool checkedAdd(Money other, Money &result) const;
+
+    /**
+     * Subtracts an amount with an overflow check.
+     * @param other The amount to subtract.
+     * @param result Receives the difference on success.
+     * @return true if the difference fits, false on overflow.
+    */
+    bool checkedSub(Money other, Money &result) const;
+
+    // Formats the amount with FRACTION_DIGITS decimals, e.g. "1040.45".
+    std::string toString() const;
+
+    bool operator==(Money other) const { return minor == other.minor; }
+    bool operator!=(Money other) const { return minor != other.minor; }
+    bool operator<(Money other) const { return minor < other.minor; }
+    bool operator<=(Money other) const { return minor <= other.minor; }
+    bool operator>(Money other) const { return minor > other.minor; }
+    bool operator>=(Money other) const { return minor >= other.minor; }
+
+private:
+    std::int64_t minor; // Amount in minor units
+};
+
+// Writes Money::toString() so that stream width and alignment still apply.
+std::ostream& operator<<(std::ostream &os, Money amount);
+
+#endif // MONEY_H
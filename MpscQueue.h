@@ -0,0 +1,72 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+// The MpscQueue class is an unbounded, intrusive, lock-free queue for many producer
+// threads and one consumer thread (Vyukov's design). The queue stores no copies and
+// allocates nothing: every element is a caller-owned Node with a member
+//
+//   std::atomic<Node*> next;
+//
+// and can sit in at most one queue at a time. push() is a single atomic exchange and
+// never waits. pop() may briefly report the queue empty while a producer is halfway
+// through a push; the element shows up on a later pop().
+template <typename Node>
+class MpscQueue {
+public:
+    MpscQueue() : head(&stub), tail(&stub) {
+        stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * Appends a node. Safe to call from any number of threads at once.
+     * @param node The node to append; it must stay alive until popped.
+    */
+    void push(Node *node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node *previous = head.exchange(node); // Sequentially consistent, for callers pairing it with a sleep flag
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Removes the oldest node. Only the consumer thread may call it.
+     * @return The node, or nullptr if none is ready.
+    */
+    Node* pop() {
+        Node *first = tail;
+        Node *next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (next == nullptr) return nullptr;
+            tail = next; // Skip the stub.
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail = next;
+            return first;
+        }
+        // first is the last node. Unless a push is in flight, put the stub back
+        // behind it so first can be handed out without leaving the queue empty.
+        if (first != head.load(std::memory_order_acquire)) return nullptr;
+        push(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next == nullptr) return nullptr;
+        tail = next;
+        return first;
+    }
+
+    // Tells whether every node pushed so far was popped. Only the consumer thread may call it.
+    bool empty() const {
+        return tail == &stub && head.load() == &stub;
+    }
+
+private:
+    Node stub;                  // Placeholder keeping the list non-empty
+    std::atomic<Node*> head;    // Last node pushed; producers swap themselves in here
+    Node *tail;                 // Next node to pop; owned by the consumer
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <thread>
+#include "NameIndex.h"
+
+const std::size_t TRIGRAM_LENGTH = 3;
+
+// Names split into trigrams per round of NameIndex::addBatch(), which bounds its memory.
+const std::size_t NAME_BATCH_ROUND = 1 << 18;
+
+// Below this many names per thread, starting the threads costs more than they save.
+const std::size_t MIN_NAMES_PER_THREAD = 1 << 14;
+
+/**
+ * Runs a task on a number of threads, the calling thread included, and waits for them.
+ * @param threads The number of threads.
+ * @param task Called with each thread's index, from 0 to threads - 1.
+ */
+template <typename Task>
+static void runOnThreads(std::size_t threads, Task task) {
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < threads; ++t) workers.emplace_back(task, t);
+    task(0);
+    for (auto &worker : workers) worker.join();
+}
+
+/**
+ * Packs the three bytes starting at text[i] into one integer key.
+ */
+static std::uint32_t trigramAt(std::string_view text, std::size_t i) {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 2]));
+}
+
+std::vector<std::uint32_t> NameIndex::trigramsOf(std::string_view text) {
+    std::vector<std::uint32_t> trigrams;
+    for (std::size_t i = 0; i + TRIGRAM_LENGTH <= text.size(); ++i) {
+        trigrams.push_back(trigramAt(text, i));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+void NameIndex::add(std::uint32_t slot, std::string_view name) {
+    if (slot >= nameBySlot.size()) nameBySlot.resize(slot + 1);
+    nameBySlot[slot] = name;
+    for (std::uint32_t trigram : trigramsOf(name)) {
+        postings[trigram].slots.push_back(slot);
+    }
+}
+
+void NameIndex::addBatch(const std::vector<std::pair<std::string_view, std::uint32_t>> &names, std::size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<std::size_t>(1, std::min(threads, std::min(names.size(), NAME_BATCH_ROUND) / MIN_NAMES_PER_THREAD));
+    std::uint32_t slots = 0;
+    for (const auto &entry : names) slots = std::max(slots, entry.second + 1);
+    if (slots > nameBySlot.size()) nameBySlot.resize(slots);
+    for (const auto &entry : names) nameBySlot[entry.second] = entry.first;
+
+    // Each trigram belongs to one thread, the only one that appends to its posting list.
+    auto ownerOf = [threads](std::uint32_t trigram) { return (trigram * 2654435761u >> 16) % threads; };
+    // (trigram, slot) pairs of a round, by producing thread and then by owning thread.
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> produced(threads * threads);
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> deferred(threads);
+    for (std::size_t first = 0; first < names.size(); first += NAME_BATCH_ROUND) {
+        std::size_t count = std::min(NAME_BATCH_ROUND, names.size() - first);
+        runOnThreads(threads, [&](std::size_t t) {
+            for (std::size_t owner = 0; owner < threads; ++owner) produced[t * threads + owner].clear();
+            std::vector<std::uint32_t> trigrams;
+            for (std::size_t i = first + count * t / threads; i < first + count * (t + 1) / threads; ++i) {
+                std::string_view name = names[i].first;
+                trigrams.clear();
+                for (std::size_t k = 0; k + TRIGRAM_LENGTH <= name.size(); ++k) trigrams.push_back(trigramAt(name, k));
+                std::sort(trigrams.begin(), trigrams.end());
+                trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+                for (std::uint32_t trigram : trigrams) {
+                    produced[t * threads + ownerOf(trigram)].emplace_back(trigram, names[i].second);
+                }
+            }
+        });
+        // Append to the existing posting lists, each thread to those of its own trigrams.
+        // Pairs whose trigram has no list yet wait for the serial step below.
+        runOnThreads(threads, [&](std::size_t t) {
+            deferred[t].clear();
+            for (std::size_t producer = 0; producer < threads; ++producer) {
+                for (const auto &[trigram, slot] : produced[producer * threads + t]) {
+                    auto it = postings.find(trigram);
+                    if (it == postings.end()) deferred[t].emplace_back(trigram, slot);
+                    else it->second.slots.push_back(slot);
+                }
+            }
+        });
+        // Only this step adds posting lists, so the threads above could look lists up concurrently.
+        for (const auto &pairs : deferred) {
+            for (const auto &[trigram, slot] : pairs) postings[trigram].slots.push_back(slot);
+        }
+    }
+}
+
+void NameIndex::remove(std::uint32_t slot, std::string_view name) {
+    if (slot >= nameBySlot.size()) return;
+    nameBySlot[slot] = std::string_view();
+    for (std::uint32_t trigram : trigramsOf(name)) {
+        auto it = postings.find(trigram);
+        if (it == postings.end()) continue;
+        PostingList &list = it->second;
+        if (++list.stale * 2 < list.slots.size()) continue;
+        clean(list, trigram);
+        if (list.slots.empty()) postings.erase(it);
+    }
+}
+
+void NameIndex::clean(PostingList &list, std::uint32_t trigram) {
+    std::sort(list.slots.begin(), list.slots.end());
+    list.slots.erase(std::unique(list.slots.begin(), list.slots.end()), list.slots.end());
+    list.slots.erase(std::remove_if(list.slots.begin(), list.slots.end(), [&](std::uint32_t slot) {
+        std::string_view name = nameBySlot[slot];
+        for (std::size_t i = 0; i + TRIGRAM_LENGTH <= name.size(); ++i) {
+            if (trigramAt(name, i) == trigram) return false;
+        }
+        return true;
+    }), list.slots.end());
+    list.slots.shrink_to_fit();
+    list.stale = 0;
+}
+
+void NameIndex::clear() {
+    postings.clear();
+    nameBySlot.clear();
+}
+
+bool NameIndex::canSearch(std::string_view text) {
+    return text.size() >= TRIGRAM_LENGTH;
+}
+
+std::vector<std::uint32_t> NameIndex::matches(std::string_view text) const {
+    // Every match is on the posting list of each of the query's trigrams, so the
+    // shortest of those lists is a complete candidate set.
+    const PostingList *shortest = nullptr;
+    for (std::uint32_t trigram : trigramsOf(text)) {
+        auto it = postings.find(trigram);
+        if (it == postings.end()) return {}; // No name contains this trigram.
+        if (shortest == nullptr || it->second.slots.size() < shortest->slots.size()) {
+            shortest = &it->second;
+        }
+    }
+    std::vector<std::uint32_t> slots;
+    for (std::uint32_t slot : shortest->slots) {
+        // Sharing one trigram is not enough, and the entry may be stale.
+        if (nameBySlot[slot].find(text) != std::string_view::npos) slots.push_back(slot);
+    }
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    return slots;
+}
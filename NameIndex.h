@@ -0,0 +1,87 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The NameIndex class is a trigram index over account holder names. Every run of
+// three consecutive characters in a name maps to a posting list of the slots whose
+// name contains it, so a substring search only has to check the accounts on the
+// shortest posting list of the query's trigrams instead of scanning every name.
+//
+// Posting lists are plain vectors: adding appends, and removing only counts the
+// entry as stale. A list is cleaned once half of it is stale, so removals cost
+// O(1) amortized. Searches check every candidate against the indexed name, which
+// makes stale entries harmless.
+class NameIndex {
+public:
+    /**
+     * Adds an account's name to the index.
+     * @param slot The account's slot in the AccountStore.
+     * @param name The name of the account holder. Must outlive the index entry.
+    */
+    void add(std::uint32_t slot, std::string_view name);
+
+    /**
+     * Adds many accounts' names at once. The names are split into trigrams on several
+     * threads, and each thread then appends to the posting lists of the trigrams it
+     * owns, so the threads never write to the same list.
+     * @param names The (name, slot) pairs to add, best in ascending slot order. The
+     * names must outlive their index entries.
+     * @param threads The number of threads to use; 0 uses one per hardware thread.
+    */
+    void addBatch(const std::vector<std::pair<std::string_view, std::uint32_t>> &names, std::size_t threads = 0);
+
+    /**
+     * Removes an account's name from the index.
+     * @param slot The account's slot in the AccountStore.
+     * @param name The name the account was added with.
+    */
+    void remove(std::uint32_t slot, std::string_view name);
+
+    // Removes every entry.
+    void clear();
+
+    /**
+     * Tells whether a query is long enough to be answered from the index.
+     * Queries shorter than three characters have no trigrams.
+     * @param text The substring that will be searched for.
+    */
+    static bool canSearch(std::string_view text);
+
+    /**
+     * Returns the slots of indexed accounts whose names contain the query.
+     * Requires canSearch(text).
+     * @param text The substring to look for.
+     * @return The matching slots in ascending order.
+    */
+    std::vector<std::uint32_t> matches(std::string_view text) const;
+
+private:
+    // The slots whose names contain one trigram.
+    struct PostingList {
+        std::vector<std::uint32_t> slots;   // May hold stale and duplicate entries
+        std::size_t stale = 0;              // Number of removals since the last clean
+    };
+
+    /**
+     * Collects the distinct trigrams of a string.
+     * @param text The string to split into trigrams.
+    */
+    static std::vector<std::uint32_t> trigramsOf(std::string_view text);
+
+    /**
+     * Drops the entries of a list whose slot no longer holds a name with the trigram.
+     * @param list The list to clean.
+     * @param trigram The trigram the list belongs to.
+    */
+    void clean(PostingList &list, std::uint32_t trigram);
+
+    std::unordered_map<std::uint32_t, PostingList> postings; // Trigram -> posting list
+    std::vector<std::string_view> nameBySlot;                // Indexed name of each slot, empty if none
+};
+
+#endif // NAME_INDEX_H
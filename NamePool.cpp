@@ -0,0 +1,45 @@
+#include <cstring>
+#include "NamePool.h"
+
+NamePool& NamePool::instance() {
+    static NamePool pool;
+    return pool;
+}
+
+std::string_view NamePool::intern(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = names.find(name);
+    if (it != names.end()) return *it;
+    std::string_view pooled = store(name);
+    names.insert(pooled);
+    return pooled;
+}
+
+void NamePool::reserve(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.reserve(names.size() + count);
+}
+
+std::size_t NamePool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.size();
+}
+
+std::string_view NamePool::store(std::string_view name) {
+    if (name.empty()) return std::string_view();
+    char *target;
+    if (name.size() > CHUNK_BYTES / 4) {
+        // Oversized names get a block of their own instead of wasting the current chunk.
+        largeNames.emplace_back(new char[name.size()]);
+        target = largeNames.back().get();
+    } else {
+        if (chunkUsed + name.size() > CHUNK_BYTES) {
+            chunks.emplace_back(new char[CHUNK_BYTES]);
+            chunkUsed = 0;
+        }
+        target = chunks.back().get() + chunkUsed;
+        chunkUsed += name.size();
+    }
+    std::memcpy(target, name.data(), name.size());
+    return std::string_view(target, name.size());
+}
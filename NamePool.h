@@ -0,0 +1,49 @@
+#ifndef NAME_POOL_H
+#define NAME_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// The NamePool class interns account holder names. Each distinct name is stored
+// once in an append-only arena, and every Account holding that name refers to the
+// same bytes through a std::string_view. Interned names are never freed, so the
+// views stay valid for the lifetime of the process.
+class NamePool {
+public:
+    // Returns the process-wide pool used by Account.
+    static NamePool& instance();
+
+    /**
+     * Returns the interned copy of a name, storing it on first use.
+     * @param name The name to intern.
+     * @return A view of the pooled copy, equal to name.
+    */
+    std::string_view intern(std::string_view name);
+
+    /**
+     * Prepares the pool for a number of additional names, avoiding rehashes during bulk loads.
+     * @param count The number of names about to be interned.
+    */
+    void reserve(std::size_t count);
+
+    // Returns the number of distinct names stored.
+    std::size_t size() const;
+
+private:
+    // Copies bytes into the arena and returns a view of the copy.
+    std::string_view store(std::string_view name);
+
+    static const std::size_t CHUNK_BYTES = 64 * 1024;   // Size of one arena chunk
+
+    mutable std::mutex mutex;                           // Guards everything below
+    std::vector<std::unique_ptr<char[]>> chunks;        // Arena chunks; never reallocated
+    std::vector<std::unique_ptr<char[]>> largeNames;    // Names too long for a chunk
+    std::size_t chunkUsed = CHUNK_BYTES;                // Bytes used in the last chunk
+    std::unordered_set<std::string_view> names;         // Views of every pooled name
+};
+
+#endif // NAME_POOL_H
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <array>
+#include <thread>
+#include "ParallelSort.h"
+
+// Bits per radix digit; 2048 counters fit comfortably in the L1 cache.
+const int RADIX_BITS = 11;
+
+// Below this many pairs a plain std::sort beats clearing and summing the radix counters.
+const std::size_t MIN_RADIX_SORT = 1 << 10;
+
+// Below this many pairs per thread, starting the threads costs more than they save.
+const std::size_t MIN_PARALLEL_SORT = 1 << 14;
+
+/**
+ * Sorts (key, slot) pairs by key, then slot, with an LSD radix sort.
+ * @param pairs The pairs to sort in place.
+ * @param keyBits The number of low bits of the order-preserving key that can differ.
+ * @param keyOf Maps a pair to an unsigned key with the same order as its key.
+ */
+template <typename Pair, typename KeyOf>
+static void radixSort(std::vector<Pair> &pairs, int keyBits, KeyOf keyOf) {
+    if (pairs.size() < MIN_RADIX_SORT) {
+        std::sort(pairs.begin(), pairs.end());
+        return;
+    }
+    const std::size_t buckets = std::size_t(1) << RADIX_BITS;
+    // Each pass is stable, so when the slots already ascend, as they do in batches
+    // built slot by slot, sorting by key alone leaves equal keys in slot order.
+    bool slotsAscend = std::is_sorted(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) {
+        return a.second < b.second;
+    });
+    const int slotDigits = slotsAscend ? 0 : (32 + RADIX_BITS - 1) / RADIX_BITS;
+    const int digits = slotDigits + (keyBits + RADIX_BITS - 1) / RADIX_BITS;
+    // The slot is the least significant part of the order, so its digits go first.
+    auto digitOf = [&](const Pair &pair, int digit) -> std::size_t {
+        if (digit < slotDigits) return (pair.second >> (digit * RADIX_BITS)) & (buckets - 1);
+        return (keyOf(pair) >> ((digit - slotDigits) * RADIX_BITS)) & (buckets - 1);
+    };
+
+    std::vector<std::array<std::size_t, buckets>> counts(digits);
+    for (auto &count : counts) count.fill(0);
+    for (const Pair &pair : pairs) {
+        for (int digit = 0; digit < digits; ++digit) ++counts[digit][digitOf(pair, digit)];
+    }
+
+    std::vector<Pair> buffer(pairs.size());
+    for (int digit = 0; digit < digits; ++digit) {
+        std::array<std::size_t, buckets> &count = counts[digit];
+        if (count[digitOf(pairs[0], digit)] == pairs.size()) continue; // Same digit everywhere
+        std::size_t offset = 0;
+        for (std::size_t &bucket : count) {
+            std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const Pair &pair : pairs) buffer[count[digitOf(pair, digit)]++] = pair;
+        pairs.swap(buffer);
+    }
+}
+
+void ParallelSort::sort(std::vector<std::pair<int, std::uint32_t>> &pairs) {
+    // Flipping the sign bit maps signed order onto unsigned order.
+    radixSort(pairs, 32, [](const std::pair<int, std::uint32_t> &pair) {
+        return std::uint64_t(std::uint32_t(pair.first) ^ 0x80000000u);
+    });
+}
+
+void ParallelSort::sort(std::vector<std::pair<std::uint32_t, std::uint32_t>> &pairs) {
+    radixSort(pairs, 32, [](const std::pair<std::uint32_t, std::uint32_t> &pair) {
+        return std::uint64_t(pair.first);
+    });
+}
+
+void ParallelSort::sort(std::vector<std::pair<Money, std::uint32_t>> &pairs) {
+    // Only the digits below the highest bit any key differs in need a pass.
+    std::uint64_t low = UINT64_MAX, high = 0;
+    auto keyOf = [](const std::pair<Money, std::uint32_t> &pair) {
+        return std::uint64_t(pair.first.minorUnits()) ^ (std::uint64_t(1) << 63);
+    };
+    for (const auto &pair : pairs) {
+        low = std::min(low, keyOf(pair));
+        high = std::max(high, keyOf(pair));
+    }
+    int keyBits = 64;
+    while (keyBits > 0 && ((low ^ high) >> (keyBits - 1)) == 0) --keyBits;
+    // Bits above keyBits are equal in every key, so they never change the order.
+    radixSort(pairs, keyBits, keyOf);
+}
+
+void ParallelSort::sort(std::vector<std::pair<std::string_view, std::uint32_t>> &pairs, std::size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, pairs.size() / MIN_PARALLEL_SORT);
+    if (threads <= 1) {
+        std::sort(pairs.begin(), pairs.end());
+        return;
+    }
+    // Sort one run per thread.
+    std::vector<std::size_t> bounds;
+    for (std::size_t i = 0; i <= threads; ++i) bounds.push_back(pairs.size() * i / threads);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&pairs, &bounds, i] {
+            std::sort(pairs.begin() + bounds[i], pairs.begin() + bounds[i + 1]);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    // Merge neighbouring runs, every merge of a round on its own thread.
+    std::vector<std::pair<std::string_view, std::uint32_t>> buffer(pairs.size());
+    while (bounds.size() > 2) {
+        std::vector<std::size_t> merged;
+        workers.clear();
+        for (std::size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            std::size_t first = bounds[i], middle = bounds[i + 1];
+            std::size_t last = i + 2 < bounds.size() ? bounds[i + 2] : middle;
+            merged.push_back(first);
+            workers.emplace_back([&pairs, &buffer, first, middle, last] {
+                std::merge(pairs.begin() + first, pairs.begin() + middle, pairs.begin() + middle,
+                           pairs.begin() + last, buffer.begin() + first);
+            });
+        }
+        merged.push_back(pairs.size());
+        for (auto &worker : workers) worker.join();
+        pairs.swap(buffer);
+        bounds.swap(merged);
+    }
+}
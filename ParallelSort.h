@@ -0,0 +1,48 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Money.h"
+
+// The ParallelSort class sorts the (key, slot) pairs the bank's ordered indexes are
+// built from, into the same order std::sort gives: by key, then by slot.
+//
+// Integer keys (ids, balances) use an LSD radix sort with 11-bit digits. One read
+// pass counts every digit, digits that are the same for every pair are skipped, and
+// each remaining digit costs one sequential scatter, so sorting takes a few linear
+// passes instead of n log n comparisons. Slots that already ascend cost no pass. Name keys use a parallel merge sort: the
+// pairs are split into one run per thread, the runs are sorted side by side, and
+// pairs of runs are merged in parallel rounds.
+class ParallelSort {
+public:
+    /**
+     * Sorts (id, slot) pairs.
+     * @param pairs The pairs to sort in place.
+    */
+    static void sort(std::vector<std::pair<int, std::uint32_t>> &pairs);
+
+    /**
+     * Sorts (slot, batch position) pairs.
+     * @param pairs The pairs to sort in place.
+    */
+    static void sort(std::vector<std::pair<std::uint32_t, std::uint32_t>> &pairs);
+
+    /**
+     * Sorts (balance, slot) pairs.
+     * @param pairs The pairs to sort in place.
+    */
+    static void sort(std::vector<std::pair<Money, std::uint32_t>> &pairs);
+
+    /**
+     * Sorts (name, slot) pairs.
+     * @param pairs The pairs to sort in place.
+     * @param threads The number of threads to use; 0 uses one per hardware thread.
+    */
+    static void sort(std::vector<std::pair<std::string_view, std::uint32_t>> &pairs, std::size_t threads = 0);
+};
+
+#endif // PARALLEL_SORT_H
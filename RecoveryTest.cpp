@@ -0,0 +1,248 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <string>
+#include <unistd.h>
+#include "BankEngine.cpp"
+
+// Checks that the bank recovers from damaged write-ahead logs, refuses damaged
+// snapshot deltas, writes only changed accounts to deltas and never keeps a
+// mutation its log lost. Build and run with
+//   g++ -std=c++20 -pthread RecoveryTest.cpp -o RecoveryTest
+//   ./RecoveryTest
+// It prints each failed check and exits with a non-zero status if there was one.
+
+const int RECOVERY_ID = 1234567;
+
+int failures = 0;
+
+/**
+ * Reports a failed check.
+ * @param passed The outcome of the check.
+ * @param what A description of what was checked.
+ */
+void expect(bool passed, const std::string &what) {
+    if (passed) return;
+    std::cout << "FAILED: " << what << std::endl;
+    ++failures;
+}
+
+/**
+ * Reads the balance of an account.
+ * @return The balance, or -1.00 if the account does not exist.
+ */
+Money balanceOf(Bank &bank, int id) {
+    const Account *acc = bank.findAccount(id);
+    return acc != nullptr ? acc->getBalance() : Money(-1, 0);
+}
+
+/**
+ * Writes a log holding the opening of an account with 100.00 followed by deposits
+ * of 10.00 and 20.00.
+ * @return The size of the log after each of its three records.
+ */
+std::vector<std::size_t> writeLog(const std::string &path) {
+    std::remove(path.c_str());
+    std::vector<std::size_t> sizes;
+    Bank bank;
+    bank.openLog(path);
+    bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+    sizes.push_back(std::ifstream(path, std::ios::binary | std::ios::ate).tellg());
+    bank.deposit(RECOVERY_ID, Money(10, 0));
+    sizes.push_back(std::ifstream(path, std::ios::binary | std::ios::ate).tellg());
+    bank.deposit(RECOVERY_ID, Money(20, 0));
+    sizes.push_back(std::ifstream(path, std::ios::binary | std::ios::ate).tellg());
+    return sizes;
+}
+
+// A crash in the middle of a write leaves a torn last record, which is dropped.
+void testTornTail(const std::string &path) {
+    std::vector<std::size_t> sizes = writeLog(path);
+    expect(::truncate(path.c_str(), static_cast<off_t>(sizes[2] - 3)) == 0, "tearing the log");
+    {
+        Bank bank;
+        expect(bank.openLog(path), "reopening a torn log");
+        expect(balanceOf(bank, RECOVERY_ID) == Money(110, 0), "replay stops before a torn record");
+        expect(bank.deposit(RECOVERY_ID, Money(5, 0)), "appending after a torn tail");
+    }
+    Bank bank;
+    expect(bank.openLog(path), "reopening a repaired log");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(115, 0), "records appended after a torn tail replay");
+}
+
+// A record whose bytes changed on disk fails its checksum and ends the log.
+void testChecksumFailure(const std::string &path) {
+    std::vector<std::size_t> sizes = writeLog(path);
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(sizes[1] - 1));
+        file.put('\x7f');
+    }
+    Bank bank;
+    expect(bank.openLog(path), "reopening a corrupt log");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(100, 0), "replay stops before a corrupt record");
+}
+
+// A snapshot whose delta cannot be read is refused instead of opened without the delta.
+void testCorruptDelta(const std::string &directory) {
+    std::string snapshotPath = directory + "/bank.snap";
+    {
+        Bank bank;
+        bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+        expect(bank.saveSnapshot(snapshotPath), "saving a snapshot");
+    }
+    {
+        Bank bank;
+        expect(bank.openSnapshot(snapshotPath) && bank.openLog(snapshotPath + ".wal"), "opening a snapshot and its log");
+        bank.deposit(RECOVERY_ID, Money(10, 0));
+        expect(bank.checkpoint(snapshotPath), "writing a delta");
+    }
+    std::vector<std::string> deltas;
+    for (const auto &entry : SnapshotMerger::deltas(snapshotPath)) deltas.push_back(entry.second);
+    expect(deltas.size() == 1, "a checkpoint writes one delta");
+    {
+        Bank bank;
+        expect(bank.openSnapshot(snapshotPath) && balanceOf(bank, RECOVERY_ID) == Money(110, 0), "deltas are applied");
+    }
+    for (const std::string &delta : deltas) expect(::truncate(delta.c_str(), 4) == 0, "corrupting a delta");
+    Bank bank;
+    expect(!bank.openSnapshot(snapshotPath), "a snapshot with a corrupt delta is refused");
+    expect(bank.findAccount(RECOVERY_ID) == nullptr, "a refused snapshot leaves the bank empty");
+    for (const std::string &delta : deltas) std::remove(delta.c_str());
+    std::remove(snapshotPath.c_str());
+    std::remove((snapshotPath + ".wal").c_str());
+}
+
+// Loading the rest of a snapshot changes nothing, so a checkpoint after one change
+// writes a delta holding that one account.
+void testOneRowDelta(const std::string &directory) {
+    std::string snapshotPath = directory + "/large.snap";
+    {
+        Bank bank;
+        for (int i = 0; i < 1000; ++i) bank.addAccount(Account(RECOVERY_ID + i, Money(100, 0), "Holder " + std::to_string(i)));
+        expect(bank.saveSnapshot(snapshotPath), "saving a snapshot of 1000 accounts");
+    }
+    {
+        Bank bank;
+        expect(bank.openSnapshot(snapshotPath) && bank.openLog(snapshotPath + ".wal"), "opening a snapshot and its log");
+        bank.deposit(RECOVERY_ID, Money(10, 0));
+        expect(bank.checkpoint(snapshotPath), "checkpointing one deposit");
+    }
+    std::vector<std::string> deltas;
+    for (const auto &entry : SnapshotMerger::deltas(snapshotPath)) deltas.push_back(entry.second);
+    Snapshot delta;
+    expect(deltas.size() == 1 && delta.open(deltas[0]) && delta.size() == 1 && delta.deletedCount() == 0,
+           "a checkpoint after one deposit writes a one-row delta");
+    delta.close();
+    {
+        Bank bank;
+        expect(bank.openSnapshot(snapshotPath) && balanceOf(bank, RECOVERY_ID) == Money(110, 0) &&
+               balanceOf(bank, RECOVERY_ID + 999) == Money(100, 0), "the one-row delta is applied");
+    }
+    for (const std::string &path : deltas) std::remove(path.c_str());
+    std::remove(snapshotPath.c_str());
+    std::remove((snapshotPath + ".wal").c_str());
+}
+
+// A mutation whose record cannot be written is undone and reported as failed.
+void testLogFailure() {
+    if (::access("/dev/full", W_OK) != 0) return; // No device that fails every write.
+    Bank bank;
+    bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+    bank.addAccount(Account(RECOVERY_ID + 2, Money(50, 0), "Grace Hopper"));
+    expect(bank.openLog("/dev/full"), "opening a log that cannot be written");
+    expect(!bank.deposit(RECOVERY_ID, Money(10, 0)), "a deposit the log lost fails");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(100, 0), "a deposit the log lost is undone");
+    expect(!bank.withdraw(RECOVERY_ID, Money(10, 0)), "a withdrawal after the log failed fails");
+    expect(!bank.transfer(RECOVERY_ID, RECOVERY_ID + 2, Money(10, 0)), "a transfer after the log failed fails");
+    std::vector<bool> succeeded;
+    expect(bank.transfer({{RECOVERY_ID + 2, RECOVERY_ID, Money(5, 0)}}, succeeded) == 0 && !succeeded[0],
+           "a batched transfer after the log failed fails");
+    std::vector<UpdateResult> results;
+    expect(bank.applyBatch({{RECOVERY_ID, BalanceUpdate::Op::Deposit, Money(5, 0)}}, results) == 0 &&
+           results[0] == UpdateResult::NotLogged, "a batched update after the log failed is not made");
+    expect(!bank.deleteAccount(RECOVERY_ID), "a deletion after the log failed fails");
+    expect(!bank.addAccount(Account(RECOVERY_ID + 1, Money(1, 0), "Alan Turing")), "an addition after the log failed fails");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(100, 0) && balanceOf(bank, RECOVERY_ID + 2) == Money(50, 0),
+           "failed mutations leave the accounts unchanged");
+    expect(bank.findAccount(RECOVERY_ID + 1) == nullptr, "a failed addition leaves no account");
+}
+
+/**
+ * Deposits 10.00 without waiting for the log, waits for the log to call back, then
+ * finishes the deposit.
+ * @return The outcome of finishMutation().
+ */
+bool depositDeferred(Bank &bank, int id) {
+    std::uint64_t sequence;
+    if (!bank.deposit(bank.findHandle(id), Money(10, 0), &sequence)) return false;
+    std::promise<void> settled;
+    bank.whenDurable(sequence, [&settled] { settled.set_value(); });
+    settled.get_future().wait();
+    return bank.finishMutation(sequence);
+}
+
+// A mutation made without waiting for the log is finished once the log calls back,
+// and undone then if the log lost it.
+void testDeferredCommit(const std::string &path) {
+    std::remove(path.c_str());
+    {
+        Bank bank;
+        bank.openLog(path);
+        bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+        expect(depositDeferred(bank, RECOVERY_ID), "a deferred deposit is finished once durable");
+    }
+    {
+        Bank bank;
+        bank.openLog(path);
+        expect(balanceOf(bank, RECOVERY_ID) == Money(110, 0), "a deferred deposit is recovered");
+    }
+    std::remove(path.c_str());
+    if (::access("/dev/full", W_OK) != 0) return;
+    Bank bank;
+    bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+    bank.openLog("/dev/full");
+    expect(!depositDeferred(bank, RECOVERY_ID), "a deferred deposit the log lost fails");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(100, 0), "a deferred deposit the log lost is undone");
+}
+
+// Updates and transfers of a batch the log lost are undone and reported as failed.
+void testBatchLogFailure() {
+    if (::access("/dev/full", W_OK) != 0) return;
+    Bank bank;
+    bank.addAccount(Account(RECOVERY_ID, Money(100, 0), "Ada Lovelace"));
+    bank.addAccount(Account(RECOVERY_ID + 2, Money(50, 0), "Grace Hopper"));
+    expect(bank.openLog("/dev/full"), "opening a log that cannot be written");
+    std::vector<UpdateResult> results;
+    std::size_t applied = bank.applyBatch({{RECOVERY_ID, BalanceUpdate::Op::Deposit, Money(5, 0)},
+                                           {RECOVERY_ID + 2, BalanceUpdate::Op::Withdraw, Money(5, 0)},
+                                           {RECOVERY_ID, BalanceUpdate::Op::Withdraw, Money(20, 0)}}, results);
+    expect(applied == 0 && std::count(results.begin(), results.end(), UpdateResult::NotLogged) == 3,
+           "a batch the log lost reports every update as not made");
+    expect(balanceOf(bank, RECOVERY_ID) == Money(100, 0) && balanceOf(bank, RECOVERY_ID + 2) == Money(50, 0),
+           "a batch the log lost is undone");
+}
+
+int main() {
+    char directory[] = "/tmp/RecoveryTestXXXXXX";
+    if (::mkdtemp(directory) == nullptr) {
+        std::cout << "Cannot create a temporary directory." << std::endl;
+        return 1;
+    }
+    std::string path = std::string(directory) + "/bank.wal";
+    testTornTail(path);
+    testChecksumFailure(path);
+    testCorruptDelta(directory);
+    testOneRowDelta(directory);
+    testLogFailure();
+    testBatchLogFailure();
+    testDeferredCommit(path);
+    std::remove(path.c_str());
+    ::rmdir(directory);
+    if (failures != 0) return 1;
+    std::cout << "All recovery checks passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "ShardedBank.h"
+
+ShardedBank::ShardedBank(std::size_t shardCount) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(shardCount, 1); ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+    // Start the workers only once the vector is complete, as they post to each other.
+    for (auto &shard : shards) {
+        Shard *owned = shard.get();
+        owned->worker = std::thread([this, owned] { work(*owned); });
+    }
+}
+
+ShardedBank::~ShardedBank() {
+    stopping.store(true);
+    for (auto &shard : shards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->sleepMutex);
+        }
+        shard->wake.notify_one();
+    }
+    for (auto &shard : shards) shard->worker.join();
+}
+
+ShardedBank::Shard& ShardedBank::shardOf(int id) {
+    // Fibonacci hashing spreads runs of consecutive ids over every shard.
+    std::uint64_t hash = static_cast<std::uint32_t>(id) * 0x9E3779B97F4A7C15ull;
+    return *shards[(hash >> 32) % shards.size()];
+}
+
+void ShardedBank::submit(Request &request) {
+    request.stage = Request::Stage::New;
+    request.finished.store(false, std::memory_order_relaxed);
+    if (request.op == Op::Total) {
+        post(*shards[static_cast<std::size_t>(request.id) % shards.size()], request);
+    } else {
+        Shard &owner = shardOf(request.id);
+        // Counted from here, so no worker stops while the transfer may still post to it.
+        if (request.op == Op::Transfer && &shardOf(request.target) != &owner) ++transfersInFlight;
+        post(owner, request);
+    }
+}
+
+void ShardedBank::wait(const Request &request) {
+    while (!request.done()) std::this_thread::yield();
+}
+
+void ShardedBank::post(Shard &shard, Request &request) {
+    shard.queue.push(&request);
+    // The push and this load are both sequentially consistent, as are the worker's
+    // store to sleeping and its check of the queue, so one of the two sees the other.
+    if (shard.sleeping.load()) {
+        std::lock_guard<std::mutex> lock(shard.sleepMutex);
+        shard.wake.notify_one();
+    }
+}
+
+void ShardedBank::work(Shard &shard) {
+    int idle = 0;
+    while (true) {
+        if (Request *request = shard.queue.pop()) {
+            handle(shard, *request);
+            idle = 0;
+            continue;
+        }
+        if (stopping.load() && shard.queue.empty()) {
+            // Another shard may still forward a credit or refund here.
+            if (transfersInFlight.load() == 0) return;
+            std::this_thread::yield();
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(shard.sleepMutex);
+        shard.sleeping.store(true);
+        if (shard.queue.empty() && !stopping.load()) shard.wake.wait(lock);
+        shard.sleeping.store(false);
+        idle = 0;
+    }
+}
+
+void ShardedBank::handle(Shard &shard, Request &request) {
+    Bank &bank = shard.bank;
+    if (request.stage == Request::Stage::Credit) {
+        if (bank.deposit(request.target, request.amount)) {
+            finishTransfer(request, true);
+        } else {
+            request.stage = Request::Stage::Refund; // The receiving account is gone or full.
+            post(shardOf(request.id), request);
+        }
+        return;
+    }
+    if (request.stage == Request::Stage::Refund) {
+        // Fails only if the payer was deleted meanwhile; the money then leaves with it,
+        // as a deleted account's balance always does.
+        bank.deposit(request.id, request.amount);
+        finishTransfer(request, false);
+        return;
+    }
+    switch (request.op) {
+        case Op::Add:
+            finish(request, bank.addAccount(Account(request.id, request.amount, request.name)));
+            break;
+        case Op::Delete:
+            finish(request, bank.deleteAccount(request.id));
+            break;
+        case Op::Deposit:
+            finish(request, bank.deposit(request.id, request.amount));
+            break;
+        case Op::Withdraw:
+            finish(request, bank.withdraw(request.id, request.amount));
+            break;
+        case Op::Balance:
+            finish(request, bank.checkBalance(bank.findHandle(request.id), request.balance));
+            break;
+        case Op::Total:
+            finish(request, bank.totalBalance(request.balance));
+            break;
+        case Op::Transfer: {
+            Shard &receiving = shardOf(request.target);
+            if (&receiving == &shard) {
+                finish(request, bank.transfer(request.id, request.target, request.amount));
+            } else if (request.amount < Money() || !bank.withdraw(request.id, request.amount)) {
+                finishTransfer(request, false);
+            } else {
+                request.stage = Request::Stage::Credit;
+                post(receiving, request);
+            }
+            break;
+        }
+    }
+}
+
+void ShardedBank::finish(Request &request, bool ok) {
+    request.ok = ok;
+    request.finished.store(true, std::memory_order_release);
+}
+
+void ShardedBank::finishTransfer(Request &request, bool ok) {
+    --transfersInFlight;
+    finish(request, ok);
+}
+
+bool ShardedBank::addAccount(const Account &account) {
+    Request request;
+    request.op = Op::Add;
+    request.id = account.getId();
+    request.amount = account.getBalance();
+    request.name = account.getName(); // Interned, so it outlives the request
+    submit(request);
+    wait(request);
+    return request.ok;
+}
+
+bool ShardedBank::deleteAccount(int id) {
+    Request request;
+    request.op = Op::Delete;
+    request.id = id;
+    submit(request);
+    wait(request);
+    return request.ok;
+}
+
+bool ShardedBank::deposit(int id, Money amount) {
+    Request request;
+    request.op = Op::Deposit;
+    request.id = id;
+    request.amount = amount;
+    submit(request);
+    wait(request);
+    return request.ok;
+}
+
+bool ShardedBank::withdraw(int id, Money amount) {
+    Request request;
+    request.op = Op::Withdraw;
+    request.id = id;
+    request.amount = amount;
+    submit(request);
+    wait(request);
+    return request.ok;
+}
+
+bool ShardedBank::checkBalance(int id, Money &balance) {
+    Request request;
+    request.op = Op::Balance;
+    request.id = id;
+    submit(request);
+    wait(request);
+    balance = request.balance;
+    return request.ok;
+}
+
+bool ShardedBank::transfer(int fromId, int toId, Money amount) {
+    Request request;
+    request.op = Op::Transfer;
+    request.id = fromId;
+    request.target = toId;
+    request.amount = amount;
+    submit(request);
+    wait(request);
+    return request.ok;
+}
+
+bool ShardedBank::totalBalance(Money &total) {
+    // One request per shard, all in flight at once.
+    std::vector<Request> requests(shards.size());
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        requests[i].op = Op::Total;
+        requests[i].id = static_cast<int>(i);
+        submit(requests[i]);
+    }
+    bool ok = true;
+    total = Money();
+    for (const Request &request : requests) {
+        wait(request);
+        ok = ok && request.ok && total.checkedAdd(request.balance, total);
+    }
+    return ok;
+}
+
+std::size_t ShardedBank::shardCount() const {
+    return shards.size();
+}
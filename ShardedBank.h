@@ -0,0 +1,163 @@
+#ifndef SHARDED_BANK_H
+#define SHARDED_BANK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Bank.h"
+#include "MpscQueue.h"
+
+// The ShardedBank class partitions accounts by id across a number of shards, each a
+// Bank owned by one worker thread that alone touches it. Callers never lock a shard:
+// they post requests to the owning shard's lock-free queue, and the worker applies
+// them one after another, so single-account operations on different shards share no
+// lock and no written cache line besides the queue they are posted to.
+//
+// A transfer between two shards is passed along as messages instead of locking both:
+// the paying shard withdraws and forwards a credit to the receiving shard, which
+// deposits, or returns a refund if it cannot. While the credit is in flight the money
+// is in neither account, so unlike Bank::transfer() a cross-shard transfer is atomic
+// (it completes or is undone as a whole) but not isolated. totalBalance() likewise
+// adds up per-shard totals taken at slightly different times.
+class ShardedBank {
+public:
+    // The operations a Request can ask for.
+    enum class Op : std::uint8_t { Add, Delete, Deposit, Withdraw, Balance, Transfer, Total };
+
+    // One request to the bank. The caller owns it and must keep it alive, unchanged,
+    // until done() returns true; then ok and balance hold the result.
+    struct Request {
+        Op op = Op::Balance;
+        int id = 0;                 // Account the request applies to: the paying one of a transfer, or a shard index for Op::Total
+        Money amount;               // Amount to move, or the opening balance of an added account
+        int target = 0;             // Receiving account of a transfer
+        std::string_view name;      // Holder name of an added account
+        bool ok = false;            // Whether the request succeeded
+        Money balance;              // The balance read by Op::Balance, or a shard's total for Op::Total
+
+        // Tells whether the request has completed.
+        bool done() const { return finished.load(std::memory_order_acquire); }
+
+    private:
+        friend class ShardedBank;
+        friend class MpscQueue<Request>;
+        enum class Stage : std::uint8_t { New, Credit, Refund };
+
+        Stage stage = Stage::New;               // Which step of a transfer the owning shard runs
+        std::atomic<bool> finished{false};      // Set by the shard that completes the request
+        std::atomic<Request*> next{nullptr};    // Link in a shard queue
+    };
+
+    /**
+     * Constructor to start a sharded bank
+     * @param shards The number of shards, each with its own worker thread.
+    */
+    explicit ShardedBank(std::size_t shards);
+
+    // Stops the workers once every posted request is done, including the credits and
+    // refunds of cross-shard transfers still passing between shards.
+    ~ShardedBank();
+    ShardedBank(const ShardedBank&) = delete;
+    ShardedBank& operator=(const ShardedBank&) = delete;
+
+    /**
+     * Posts a request to the shard owning its account and returns at once.
+     * @param request The request; see Request for its lifetime.
+    */
+    void submit(Request &request);
+
+    // Waits until a submitted request is done.
+    static void wait(const Request &request);
+
+    // The blocking operations below submit one request and wait for it.
+
+    /**
+     * Adds a new account to the shard owning its id.
+     * @return true if the account was added, false if its id is taken.
+    */
+    bool addAccount(const Account &account);
+
+    // Deletes an account; returns false if it does not exist.
+    bool deleteAccount(int id);
+
+    // Deposits into an account; returns false if it does not exist or the deposit is refused.
+    bool deposit(int id, Money amount);
+
+    // Withdraws from an account; returns false if it does not exist or lacks the funds.
+    bool withdraw(int id, Money amount);
+
+    /**
+     * Reads the balance of an account.
+     * @param balance Receives the balance.
+     * @return true if the account exists, false otherwise.
+    */
+    bool checkBalance(int id, Money &balance);
+
+    /**
+     * Moves an amount between two accounts, by message passing when they live on
+     * different shards.
+     * @return true if the money arrived, false if the transfer was refused or undone.
+    */
+    bool transfer(int fromId, int toId, Money amount);
+
+    /**
+     * Sums the shard totals.
+     * @param total Receives the sum.
+     * @return false if the sum does not fit in a Money, true otherwise.
+    */
+    bool totalBalance(Money &total);
+
+    // Returns the number of shards.
+    std::size_t shardCount() const;
+
+private:
+    // One shard: its accounts, its queue and its worker, on cache lines of their own.
+    struct alignas(64) Shard {
+        Bank bank{Bank::ConcurrencyMode::Mutex};    // Only the worker uses it, so its locks never contend
+        MpscQueue<Request> queue;                   // Requests and messages for this shard
+        std::mutex sleepMutex;                      // Guards the worker's sleep
+        std::condition_variable wake;               // Signalled when a request arrives for a sleeping worker
+        std::atomic<bool> sleeping{false};          // Set while the worker may be waiting on wake
+        std::thread worker;                         // Owns bank
+    };
+
+    static const int IDLE_SPINS = 64;   // Empty polls before a worker goes to sleep
+
+    // Helper function to return the shard owning an account id
+    Shard& shardOf(int id);
+
+    /**
+     * Helper function to queue a request or message for a shard and wake its worker
+     * @param shard The shard that must handle it
+     * @param request The request
+    */
+    void post(Shard &shard, Request &request);
+
+    // Helper function to run a shard's worker until the bank is destroyed
+    void work(Shard &shard);
+
+    /**
+     * Helper function to apply one request or message on the shard owning it
+     * @param shard The shard of the worker running it
+     * @param request The request
+    */
+    void handle(Shard &shard, Request &request);
+
+    // Helper function to publish a request's result
+    static void finish(Request &request, bool ok);
+
+    // Helper function to publish the result of a transfer between two shards
+    void finishTransfer(Request &request, bool ok);
+
+    std::vector<std::unique_ptr<Shard>> shards; // The shards, by index
+    std::atomic<bool> stopping{false};          // Set by the destructor
+    alignas(64) std::atomic<std::size_t> transfersInFlight{0}; // Cross-shard transfers submitted but not finished
+};
+
+#endif // SHARDED_BANK_H
@@ -0,0 +1,232 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Snapshot.h"
+
+// Identifies snapshot files; the trailing byte is part of the magic.
+const char SNAPSHOT_MAGIC[8] = {'A', 'T', 'M', 'S', 'N', 'A', 'P', '\0'};
+
+// The fixed-size header at the start of every snapshot file.
+struct SnapshotHeader {
+    char magic[8];                // SNAPSHOT_MAGIC
+    std::uint32_t version;        // Snapshot::VERSION
+    std::uint32_t headerSize;     // sizeof(SnapshotHeader), for later extensions
+    std::uint64_t count;          // Number of accounts
+    std::uint64_t logSequence;    // Last write-ahead log record reflected in the accounts
+    std::uint64_t idsOffset;      // File offset of the id column
+    std::uint64_t balancesOffset; // File offset of the balance column
+    std::uint64_t nameEndsOffset; // File offset of the name end column
+    std::uint64_t namesOffset;    // File offset of the name heap
+    std::uint64_t namesSize;      // Length of the name heap in bytes
+    std::uint64_t deletedOffset;  // File offset of the deleted id column
+    std::uint64_t deletedCount;   // Number of deleted ids
+};
+
+/**
+ * Rounds a file offset up to the next multiple of 8.
+ */
+static std::uint64_t alignSection(std::uint64_t offset) {
+    return (offset + 7) & ~std::uint64_t(7);
+}
+
+/**
+ * Writes a whole buffer to a file descriptor, retrying short writes.
+ * @return true if every byte was written, false otherwise.
+ */
+static bool writeAll(int fd, const void *buffer, std::size_t length) {
+    const char *bytes = static_cast<const char*>(buffer);
+    while (length > 0) {
+        ssize_t written = ::write(fd, bytes, length);
+        if (written < 0) return false;
+        bytes += written;
+        length -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+/**
+ * Flushes a directory's entries to disk, so a file renamed into it stays renamed
+ * after a crash.
+ * @param path The path of a file in the directory.
+ * @return true if the directory was flushed, false otherwise.
+ */
+static bool syncDirectory(const std::string &path) {
+    std::size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+}
+
+/**
+ * Writes zero bytes up to the given file offset.
+ * @param position The current file offset; updated to target.
+ */
+static bool padTo(int fd, std::uint64_t &position, std::uint64_t target) {
+    static const char zeros[8] = {};
+    bool ok = writeAll(fd, zeros, target - position);
+    position = target;
+    return ok;
+}
+
+bool Snapshot::write(const std::string &path, const std::function<bool(AccountRow&)> &next,
+                     const std::vector<int> &deletedIds, std::uint64_t logSequence) {
+    std::vector<std::int32_t> idColumn;
+    std::vector<std::int64_t> balanceColumn;
+    std::vector<std::uint64_t> nameEndColumn;
+    std::string nameHeap;
+    AccountRow row;
+    while (next(row)) {
+        idColumn.push_back(row.id);
+        balanceColumn.push_back(row.balance.minorUnits());
+        nameHeap.append(row.name);
+        nameEndColumn.push_back(nameHeap.size());
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.count = idColumn.size();
+    header.logSequence = logSequence;
+    header.idsOffset = alignSection(sizeof(SnapshotHeader));
+    header.balancesOffset = alignSection(header.idsOffset + idColumn.size() * sizeof(std::int32_t));
+    header.nameEndsOffset = header.balancesOffset + balanceColumn.size() * sizeof(std::int64_t);
+    header.namesOffset = header.nameEndsOffset + nameEndColumn.size() * sizeof(std::uint64_t);
+    header.namesSize = nameHeap.size();
+    header.deletedOffset = alignSection(header.namesOffset + nameHeap.size());
+    header.deletedCount = deletedIds.size();
+
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    std::uint64_t position = sizeof(SnapshotHeader);
+    bool ok = writeAll(fd, &header, sizeof(header))
+        && padTo(fd, position, header.idsOffset)
+        && writeAll(fd, idColumn.data(), idColumn.size() * sizeof(std::int32_t));
+    position = header.idsOffset + idColumn.size() * sizeof(std::int32_t);
+    ok = ok && padTo(fd, position, header.balancesOffset)
+        && writeAll(fd, balanceColumn.data(), balanceColumn.size() * sizeof(std::int64_t))
+        && writeAll(fd, nameEndColumn.data(), nameEndColumn.size() * sizeof(std::uint64_t))
+        && writeAll(fd, nameHeap.data(), nameHeap.size());
+    position = header.namesOffset + nameHeap.size();
+    std::vector<std::int32_t> deletedColumn(deletedIds.begin(), deletedIds.end());
+    ok = ok && padTo(fd, position, header.deletedOffset)
+        && writeAll(fd, deletedColumn.data(), deletedColumn.size() * sizeof(std::int32_t))
+        && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    // Callers truncate the log or remove deltas next, which must not outlive the rename.
+    return syncDirectory(path);
+}
+
+Snapshot::~Snapshot() {
+    close();
+}
+
+bool Snapshot::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+    std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+    void *mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps the file alive.
+    if (mapping == MAP_FAILED) return false;
+    data = static_cast<const char*>(mapping);
+    mappedSize = fileSize;
+
+    // Validate the header and section bounds only; the columns are not touched here.
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    std::uint64_t n = header.count;
+    bool valid = std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0
+        && header.version == VERSION
+        && header.headerSize >= sizeof(SnapshotHeader)
+        && n <= fileSize / sizeof(std::int32_t)
+        && header.idsOffset <= fileSize && header.balancesOffset <= fileSize && header.nameEndsOffset <= fileSize
+        && header.idsOffset % 8 == 0 && header.balancesOffset % 8 == 0 && header.nameEndsOffset % 8 == 0
+        && header.idsOffset + n * sizeof(std::int32_t) <= fileSize
+        && header.balancesOffset + n * sizeof(std::int64_t) <= fileSize
+        && header.nameEndsOffset + n * sizeof(std::uint64_t) <= fileSize
+        && header.namesOffset <= fileSize
+        && header.namesSize <= fileSize - header.namesOffset
+        && header.deletedOffset <= fileSize && header.deletedOffset % 8 == 0
+        && header.deletedCount <= (fileSize - header.deletedOffset) / sizeof(std::int32_t);
+    if (!valid) {
+        close();
+        return false;
+    }
+    count = n;
+    ids = reinterpret_cast<const std::int32_t*>(data + header.idsOffset);
+    balances = reinterpret_cast<const std::int64_t*>(data + header.balancesOffset);
+    nameEnds = reinterpret_cast<const std::uint64_t*>(data + header.nameEndsOffset);
+    names = data + header.namesOffset;
+    namesSize = header.namesSize;
+    sequence = header.logSequence;
+    deleted = reinterpret_cast<const std::int32_t*>(data + header.deletedOffset);
+    deletedIds = header.deletedCount;
+    return true;
+}
+
+void Snapshot::close() {
+    if (data != nullptr) ::munmap(const_cast<char*>(data), mappedSize);
+    data = nullptr;
+    mappedSize = 0;
+    count = 0;
+    ids = nullptr;
+    balances = nullptr;
+    nameEnds = nullptr;
+    names = nullptr;
+    namesSize = 0;
+    sequence = 0;
+    deleted = nullptr;
+    deletedIds = 0;
+}
+
+bool Snapshot::isOpen() const {
+    return data != nullptr;
+}
+
+std::size_t Snapshot::size() const {
+    return count;
+}
+
+std::uint64_t Snapshot::logSequence() const {
+    return sequence;
+}
+
+std::size_t Snapshot::deletedCount() const {
+    return deletedIds;
+}
+
+int Snapshot::deletedAt(std::size_t index) const {
+    return deleted[index];
+}
+
+std::size_t Snapshot::find(int id) const {
+    const std::int32_t *end = ids + count;
+    const std::int32_t *it = std::lower_bound(ids, end, id);
+    if (it == end || *it != id) return NOT_FOUND;
+    return static_cast<std::size_t>(it - ids);
+}
+
+AccountRow Snapshot::row(std::size_t index) const {
+    std::uint64_t start = index == 0 ? 0 : nameEnds[index - 1];
+    std::uint64_t end = nameEnds[index];
+    if (start > end || end > namesSize) start = end = 0; // Corrupt name offsets
+    return AccountRow{ids[index], std::string_view(names + start, end - start),
+                      Money::fromMinorUnits(balances[index])};
+}
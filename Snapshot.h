@@ -0,0 +1,109 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "AccountCsv.h"
+
+// The Snapshot class reads and writes the bank's binary snapshot file. The file has
+// a fixed layout so it can be used in place through mmap, without parsing:
+//
+//   header      magic, version, account count, last log sequence number covered,
+//               and the offset of every section
+//   ids         int32 per account, in ascending order
+//   balances    int64 minor units per account
+//   name ends   uint64 per account: end of the account's name in the name heap
+//   name heap   every holder name, back to back, without terminators
+//   deleted     int32 per deleted account, in ascending order
+//
+// A full snapshot has no deleted ids. A delta snapshot, written by an incremental
+// checkpoint, holds only the accounts added or changed since the previous
+// checkpoint, and the ids of those deleted since then.
+// All values are in the host's byte order and every section starts 8-byte aligned.
+// Opening a snapshot only maps and validates the header, so it costs the same for
+// ten accounts as for ten million; pages are read from disk when first touched.
+class Snapshot {
+public:
+    static const std::uint32_t VERSION = 3;           // Format version written by write()
+    static const std::size_t NOT_FOUND = SIZE_MAX;    // Returned by find() for unknown ids
+
+    Snapshot() = default;
+    ~Snapshot();
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    /**
+     * Writes a snapshot. The file is written next to its destination, flushed to
+     * disk and renamed over it, so a reader never sees a partial snapshot, and a
+     * snapshot that is currently open can be overwritten. The directory is flushed
+     * after the rename, so once this returns true the snapshot survives a crash.
+     * @param path The path of the snapshot file.
+     * @param next Called for each account in turn, in ascending id order; fills in
+     * the row and returns true, or returns false once there are no more accounts.
+     * @param deletedIds The ids of deleted accounts, in ascending order; empty for a full snapshot.
+     * @param logSequence The last write-ahead log record the snapshot reflects, or 0.
+     * @return true if the snapshot was written, false otherwise.
+    */
+    static bool write(const std::string &path, const std::function<bool(AccountRow&)> &next,
+                      const std::vector<int> &deletedIds, std::uint64_t logSequence);
+
+    /**
+     * Maps a snapshot file read-only, replacing any snapshot already open.
+     * @param path The path of the snapshot file.
+     * @return true if the file is a snapshot of a supported version, false otherwise.
+    */
+    bool open(const std::string &path);
+
+    // Unmaps the snapshot. Rows returned earlier must not be used afterwards.
+    void close();
+
+    // Tells whether a snapshot is mapped.
+    bool isOpen() const;
+
+    // Returns the number of accounts in the snapshot.
+    std::size_t size() const;
+
+    // Returns the last write-ahead log record reflected in the snapshot, or 0.
+    std::uint64_t logSequence() const;
+
+    // Returns the number of deleted ids recorded in a delta snapshot.
+    std::size_t deletedCount() const;
+
+    /**
+     * Reads one deleted id of a delta snapshot.
+     * @param index An index below deletedCount().
+    */
+    int deletedAt(std::size_t index) const;
+
+    /**
+     * Finds an account by binary search over the id column.
+     * @param id The account id to look for.
+     * @return The row index of the account, or NOT_FOUND.
+    */
+    std::size_t find(int id) const;
+
+    /**
+     * Reads one account without copying its name.
+     * @param index A row index below size().
+     * @return The row; its name points into the mapping and lives until close().
+    */
+    AccountRow row(std::size_t index) const;
+
+private:
+    const char *data = nullptr;               // Start of the mapping
+    std::size_t mappedSize = 0;               // Length of the mapping in bytes
+    std::size_t count = 0;                    // Number of accounts
+    const std::int32_t *ids = nullptr;        // Id column
+    const std::int64_t *balances = nullptr;   // Balance column
+    const std::uint64_t *nameEnds = nullptr;  // End offset of each name in the heap
+    const char *names = nullptr;              // Name heap
+    std::size_t namesSize = 0;                // Length of the name heap in bytes
+    std::uint64_t sequence = 0;               // Last log record reflected in the snapshot
+    const std::int32_t *deleted = nullptr;    // Deleted id column
+    std::size_t deletedIds = 0;               // Number of deleted ids
+};
+
+#endif // SNAPSHOT_H
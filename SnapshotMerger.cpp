@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include "SnapshotMerger.h"
+#include "Snapshot.h"
+
+// Separates a base snapshot's name from the sequence number of its deltas.
+const std::string DELTA_SUFFIX = ".delta.";
+
+SnapshotMerger::~SnapshotMerger() {
+    wait();
+}
+
+std::string SnapshotMerger::deltaPath(const std::string &basePath, std::uint64_t sequence) {
+    return basePath + DELTA_SUFFIX + std::to_string(sequence);
+}
+
+std::vector<std::pair<std::uint64_t, std::string>> SnapshotMerger::deltas(const std::string &basePath) {
+    namespace fs = std::filesystem;
+    std::vector<std::pair<std::uint64_t, std::string>> found;
+    fs::path base(basePath);
+    fs::path directory = base.has_parent_path() ? base.parent_path() : fs::path(".");
+    std::string prefix = base.filename().string() + DELTA_SUFFIX;
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0) continue;
+        std::uint64_t sequence;
+        const char *first = name.data() + prefix.size();
+        const char *last = name.data() + name.size();
+        auto [ptr, parseError] = std::from_chars(first, last, sequence);
+        if (parseError != std::errc() || ptr != last || first == last) continue; // e.g. a ".tmp" file
+        found.emplace_back(sequence, entry.path().string());
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+void SnapshotMerger::removeDeltas(const std::string &basePath, std::uint64_t upToSequence) {
+    for (const auto &delta : deltas(basePath)) {
+        if (delta.first <= upToSequence) std::remove(delta.second.c_str());
+    }
+}
+
+bool SnapshotMerger::merge(const std::string &basePath) {
+    Snapshot base;
+    if (!base.open(basePath)) return false;
+
+    // Fold the deltas, oldest first, into one change per id: the latest row, or
+    // nothing for an account deleted last. Deltas are small next to the base.
+    std::vector<std::unique_ptr<Snapshot>> opened;
+    std::map<int, std::optional<AccountRow>> changes;
+    std::uint64_t lastSequence = base.logSequence();
+    for (const auto &delta : deltas(basePath)) {
+        if (delta.first <= base.logSequence()) continue;
+        opened.push_back(std::make_unique<Snapshot>());
+        Snapshot &snapshot = *opened.back();
+        if (!snapshot.open(delta.second)) return false;
+        for (std::size_t i = 0; i < snapshot.deletedCount(); ++i) {
+            changes[snapshot.deletedAt(i)] = std::nullopt;
+        }
+        for (std::size_t i = 0; i < snapshot.size(); ++i) {
+            AccountRow row = snapshot.row(i);
+            changes[row.id] = row;
+        }
+        lastSequence = snapshot.logSequence();
+    }
+    if (opened.empty()) return true;
+
+    // Both the base and the changes are in id order, so one merge pass builds the new base.
+    std::size_t next = 0;
+    auto change = changes.begin();
+    auto nextRow = [&](AccountRow &row) {
+        while (next < base.size() || change != changes.end()) {
+            if (change == changes.end() || (next < base.size() && base.row(next).id < change->first)) {
+                row = base.row(next++);
+                return true;
+            }
+            if (next < base.size() && base.row(next).id == change->first) ++next; // Replaced or deleted
+            const std::optional<AccountRow> &changed = (change++)->second;
+            if (changed) {
+                row = *changed;
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!Snapshot::write(basePath, nextRow, {}, lastSequence)) return false;
+    removeDeltas(basePath, lastSequence);
+    return true;
+}
+
+bool SnapshotMerger::start(const std::string &basePath) {
+    if (running) return false;
+    if (worker.joinable()) worker.join();
+    running = true;
+    worker = std::thread([this, basePath] {
+        merge(basePath);
+        running = false;
+    });
+    return true;
+}
+
+void SnapshotMerger::wait() {
+    if (worker.joinable()) worker.join();
+}
+
+bool SnapshotMerger::isRunning() const {
+    return running;
+}
@@ -0,0 +1,70 @@
+#ifndef SNAPSHOT_MERGER_H
+#define SNAPSHOT_MERGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The SnapshotMerger class manages the delta snapshots written next to a base
+// snapshot by incremental checkpoints, and folds them into the base in the
+// background. A delta for base "bank.snap" is named "bank.snap.delta.<sequence>",
+// where sequence is the last log record it reflects. Deltas whose sequence is not
+// above the base's are already part of it and are ignored.
+class SnapshotMerger {
+public:
+    SnapshotMerger() = default;
+    ~SnapshotMerger();
+    SnapshotMerger(const SnapshotMerger&) = delete;
+    SnapshotMerger& operator=(const SnapshotMerger&) = delete;
+
+    /**
+     * Returns the name of the delta snapshot for a base and a log sequence number.
+    */
+    static std::string deltaPath(const std::string &basePath, std::uint64_t sequence);
+
+    /**
+     * Lists the delta snapshots of a base that exist on disk.
+     * @param basePath The path of the base snapshot.
+     * @return Pairs of log sequence number and path, in ascending sequence order.
+    */
+    static std::vector<std::pair<std::uint64_t, std::string>> deltas(const std::string &basePath);
+
+    /**
+     * Deletes the delta snapshots of a base up to a log sequence number.
+     * @param basePath The path of the base snapshot.
+     * @param upToSequence Deltas with a sequence up to this one are deleted.
+    */
+    static void removeDeltas(const std::string &basePath, std::uint64_t upToSequence);
+
+    /**
+     * Folds every delta of a base into a new base, in one streaming pass over the
+     * base's id column, then replaces the base atomically and deletes the deltas.
+     * @param basePath The path of the base snapshot.
+     * @return true if the deltas were merged or there were none, false otherwise.
+    */
+    static bool merge(const std::string &basePath);
+
+    /**
+     * Starts merging a base's deltas on a background thread, unless a merge is
+     * already running. The bank keeps serving meanwhile: a snapshot it has mapped
+     * stays valid after the base file is replaced.
+     * @param basePath The path of the base snapshot.
+     * @return true if a merge was started, false if one is still running.
+    */
+    bool start(const std::string &basePath);
+
+    // Waits for a background merge to finish, if one is running.
+    void wait();
+
+    // Tells whether a background merge is running.
+    bool isRunning() const;
+
+private:
+    std::thread worker;                 // Runs the background merge
+    std::atomic<bool> running{false};   // Set while the worker is merging
+};
+
+#endif // SNAPSHOT_MERGER_H
@@ -0,0 +1,55 @@
+#include <iterator>
+#include <thread>
+#include "ParallelSort.h"
+#include "SortedViews.h"
+
+void SortedViews::add(std::uint32_t slot, int id, std::string_view name) {
+    byName.emplace(name, slot);
+    byId.emplace(id, slot);
+}
+
+void SortedViews::addBatch(std::vector<std::pair<std::string_view, std::uint32_t>> names,
+                           std::vector<std::pair<int, std::uint32_t>> ids) {
+    // The two orders are independent, so build them side by side.
+    std::thread idBuilder([&] {
+        ParallelSort::sort(ids);
+        auto idHint = byId.begin();
+        for (const auto &entry : ids) {
+            idHint = std::next(byId.insert(idHint, entry));
+        }
+    });
+    ParallelSort::sort(names);
+    auto nameHint = byName.begin();
+    for (const auto &entry : names) {
+        nameHint = std::next(byName.insert(nameHint, entry));
+    }
+    idBuilder.join();
+}
+
+void SortedViews::remove(std::uint32_t slot, int id, std::string_view name) {
+    byName.erase({name, slot});
+    byId.erase({id, slot});
+}
+
+void SortedViews::clear() {
+    byName.clear();
+    byId.clear();
+}
+
+std::vector<std::uint32_t> SortedViews::slotsByName() const {
+    std::vector<std::uint32_t> slots;
+    slots.reserve(byName.size());
+    for (const auto &entry : byName) {
+        slots.push_back(entry.second);
+    }
+    return slots;
+}
+
+std::vector<std::uint32_t> SortedViews::slotsById() const {
+    std::vector<std::uint32_t> slots;
+    slots.reserve(byId.size());
+    for (const auto &entry : byId) {
+        slots.push_back(entry.second);
+    }
+    return slots;
+}
@@ -0,0 +1,56 @@
+#ifndef SORTED_VIEWS_H
+#define SORTED_VIEWS_H
+
+#include <cstdint>
+#include <set>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The SortedViews class maintains the name and id orderings of the bank's accounts
+// as ordered sets of account slots. Each add or remove costs O(log n), and listing
+// an ordering walks it in O(n) without sorting or moving any Account.
+// The balance ordering is kept by BalanceIndex.
+class SortedViews {
+public:
+    /**
+     * Adds an account to every view.
+     * @param slot The account's slot in the AccountStore.
+     * @param id The account's unique ID.
+     * @param name The name of the account holder.
+    */
+    void add(std::uint32_t slot, int id, std::string_view name);
+
+    /**
+     * Removes an account from every view.
+     * @param slot The account's slot in the AccountStore.
+     * @param id The account's unique ID.
+     * @param name The name the account was added with.
+    */
+    void remove(std::uint32_t slot, int id, std::string_view name);
+
+    /**
+     * Adds many accounts at once. Each batch is sorted first so that every insert
+     * uses the previous position as a hint, which is linear when the views start empty.
+     * The name and id views are built on two threads.
+     * @param names (name, slot) pairs for accounts that are not in the views yet.
+     * @param ids (id, slot) pairs for the same accounts.
+    */
+    void addBatch(std::vector<std::pair<std::string_view, std::uint32_t>> names,
+                  std::vector<std::pair<int, std::uint32_t>> ids);
+
+    // Removes every entry.
+    void clear();
+
+    // Returns every slot ordered by holder name, then by slot.
+    std::vector<std::uint32_t> slotsByName() const;
+
+    // Returns every slot ordered by account id.
+    std::vector<std::uint32_t> slotsById() const;
+
+private:
+    std::set<std::pair<std::string_view, std::uint32_t>> byName; // (name, slot); names are pooled
+    std::set<std::pair<int, std::uint32_t>> byId;           // (id, slot) pairs in ascending order
+};
+
+#endif // SORTED_VIEWS_H
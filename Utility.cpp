@@ -1,3 +1,4 @@
+#include <charconv>
 #include "Utility.h"
 
 void Utility::clearCinBuffer() {
@@ -46,12 +47,43 @@ bool Utility::isDouble(const std::string& amount) {
     }
 }
 
-double Utility::getAmount() {
+Money Utility::getAmount() {
     std::string validAmount;
     clearCinBuffer(); // Clear the input buffer before reading.
     std::getline(std::cin, validAmount); // Read a line of input as a string.
-    if (isDouble(validAmount)) { // Check if the input string is a valid double.
-        return std::stod(validAmount); // Convert the string to a double and return.
+    Money amount;
+    if (Money::parse(validAmount, amount)) { // Parse the exact amount without going through a double.
+        return amount;
     }
-    return -1; // Return -1 if the input is not a valid double.
+    return Money(-1, 0); // Return a negative amount if the input is not a valid amount.
+}
+
+std::string_view Utility::trim(std::string_view input) {
+    std::size_t start = input.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) return std::string_view();
+    std::size_t end = input.find_last_not_of(" \t\r");
+    return input.substr(start, end - start + 1);
+}
+
+bool Utility::isNumber(std::string_view input, int numberLen) {
+    input = trim(input);
+    if (input.length() != static_cast<std::size_t>(numberLen)) return false;
+    for (char c : input) {
+        if (!isdigit(static_cast<unsigned char>(c))) return false; // Every character must be a digit.
+    }
+    return true;
+}
+
+bool Utility::parseNumber(std::string_view input, int &number) {
+    input = trim(input);
+    auto [ptr, error] = std::from_chars(input.data(), input.data() + input.size(), number);
+    return !input.empty() && error == std::errc() && ptr == input.data() + input.size();
+}
+
+Money Utility::parseAmount(std::string_view input) {
+    Money amount;
+    if (Money::parse(trim(input), amount)) { // Parse the exact amount without going through a double.
+        return amount;
+    }
+    return Money(-1, 0); // Return a negative amount if the input is not a valid amount.
 }
@@ -3,6 +3,9 @@
 
 #include <iostream>
 #include <limits>
+#include <string>
+#include <string_view>
+#include "Money.h"
 
 /**
  * The Utility class provides utility functions for input validation
@@ -40,11 +43,48 @@ public:
     bool isDouble(const std::string& amount);
 
     /**
-     * Reads a double value from standard input. Ensures the validation of the input.
+     * Reads a monetary amount from standard input. Ensures the validation of the input.
      * 
-     * @return The read double value. Returns -1 if the input is not a valid double.
+     * @return The read amount. Returns a negative amount if the input is not a valid amount.
      */
-    double getAmount();
+    Money getAmount();
+
+    // The functions below only look at a line that was already read, so menus that
+    // get their input from somewhere other than standard input can use them too.
+
+    /**
+     * Removes the spaces, tabs and carriage returns around a line of input.
+     * 
+     * @param input The line to trim.
+     * @return The trimmed line, viewing into input.
+     */
+    std::string_view trim(std::string_view input);
+
+    /**
+     * Checks if a line holds a number of specified length, without printing anything.
+     * 
+     * @param input The line to check; surrounding spaces are ignored.
+     * @param numberLen The expected length of the number.
+     * @return true if input is a number with the specified length, false otherwise.
+     */
+    bool isNumber(std::string_view input, int numberLen);
+
+    /**
+     * Parses a line holding a single integer, such as a menu choice.
+     * 
+     * @param input The line to parse; surrounding spaces are ignored.
+     * @param number Receives the integer.
+     * @return true if the whole line is an integer, false otherwise.
+     */
+    bool parseNumber(std::string_view input, int &number);
+
+    /**
+     * Parses a line holding a monetary amount.
+     * 
+     * @param input The line to parse; surrounding spaces are ignored.
+     * @return The amount. Returns a negative amount if the input is not a valid amount.
+     */
+    Money parseAmount(std::string_view input);
 };
 
 #endif // UTILITY_H
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cmath>
+#include "Workload.h"
+
+/**
+ * Returns log(1 + x) / x, continued smoothly to 1 at x = 0.
+ */
+static double log1pOverX(double x) {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x / 2;
+}
+
+/**
+ * Returns (exp(x) - 1) / x, continued smoothly to 1 at x = 0.
+ */
+static double expm1OverX(double x) {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x / 2;
+}
+
+Workload::Workload(std::size_t accounts, double skew, std::uint64_t seed)
+    : accounts(std::max<std::size_t>(accounts, 1)), skew(skew), random(seed) {
+    hIntegralLow = hIntegral(1.5) - 1;
+    hIntegralHigh = hIntegral(this->accounts + 0.5);
+    squeeze = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+}
+
+double Workload::h(double x) const {
+    return std::exp(-skew * std::log(x));
+}
+
+double Workload::hIntegral(double x) const {
+    double logX = std::log(x);
+    return expm1OverX((1 - skew) * logX) * logX;
+}
+
+double Workload::hIntegralInverse(double x) const {
+    double t = std::max(x * (1 - skew), -1.0);
+    return std::exp(log1pOverX(t) * x);
+}
+
+std::size_t Workload::nextAccount() {
+    if (skew == 0) return std::uniform_int_distribution<std::size_t>(0, accounts - 1)(random);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    while (true) {
+        // Invert the integral of h at a uniform point, round to the nearest rank, and
+        // accept it if the point falls under h's step at that rank.
+        double u = hIntegralHigh + uniform(random) * (hIntegralLow - hIntegralHigh);
+        double x = hIntegralInverse(u);
+        double rank = std::clamp(std::floor(x + 0.5), 1.0, double(accounts));
+        if (rank - x <= squeeze || u >= hIntegral(rank + 0.5) - h(rank)) {
+            return static_cast<std::size_t>(rank) - 1;
+        }
+    }
+}
+
+std::pair<std::size_t, std::size_t> Workload::nextPair() {
+    std::size_t first = nextAccount();
+    std::size_t second;
+    do {
+        second = nextAccount();
+    } while (second == first);
+    return {first, second};
+}
@@ -0,0 +1,52 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+// The Workload class draws the accounts a synthetic workload touches, as indices
+// into a population of accounts. With a skew of 0 every account is equally likely;
+// with a positive skew s, index k (counting from 0) is drawn with probability
+// proportional to 1 / (k + 1)^s, the Zipf distribution real account traffic tends
+// to follow: a few hot accounts take most of the operations. Zipf indices are drawn
+// by rejection-inversion (Hormann and Derflinger), in O(1) time and memory whatever
+// the number of accounts.
+class Workload {
+public:
+    static constexpr int FIRST_ID = 1000000;    // First synthetic account id, so that every id has 7 digits like real ones
+
+    /**
+     * Constructor to create a workload over a number of accounts
+     * @param accounts The number of accounts; indices are drawn from [0, accounts).
+     * @param skew The Zipf exponent, or 0 for a uniform workload.
+     * @param seed The seed of the random number generator, so runs can be repeated.
+    */
+    Workload(std::size_t accounts, double skew, std::uint64_t seed);
+
+    // Draws the index of the next account touched.
+    std::size_t nextAccount();
+
+    // Draws two different account indices, e.g. the two sides of a transfer. Needs two accounts or more.
+    std::pair<std::size_t, std::size_t> nextPair();
+
+private:
+    // The Zipf weight 1 / x^skew
+    double h(double x) const;
+
+    // An antiderivative of h
+    double hIntegral(double x) const;
+
+    // The inverse of hIntegral
+    double hIntegralInverse(double x) const;
+
+    std::size_t accounts;           // Size of the population
+    double skew;                    // Zipf exponent; 0 for uniform
+    double hIntegralLow;            // hIntegral(1.5) - 1
+    double hIntegralHigh;           // hIntegral(accounts + 0.5)
+    double squeeze;                 // Accepts most draws without evaluating hIntegral
+    std::mt19937_64 random;         // Source of uniform bits
+};
+
+#endif // WORKLOAD_H
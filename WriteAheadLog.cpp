@@ -0,0 +1,276 @@
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "WriteAheadLog.h"
+
+// Size of the length and checksum fields in front of every payload.
+const std::size_t LOG_FRAME_BYTES = 8;
+
+// Size of a payload without its name: sequence, op, id and amount.
+const std::size_t LOG_FIXED_PAYLOAD = 8 + 1 + 4 + 8;
+
+/**
+ * Computes the CRC-32 (IEEE) checksum of a buffer.
+ */
+static std::uint32_t crc32(const char *data, std::size_t length) {
+    static const std::vector<std::uint32_t> table = [] {
+        std::vector<std::uint32_t> entries(256);
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * Appends the raw bytes of a value to a buffer.
+ */
+template <typename T>
+static void putValue(std::string &buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * Reads a value from raw bytes.
+ */
+template <typename T>
+static T getValue(const char *bytes) {
+    T value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string &path, std::uint64_t afterSequence,
+                         const std::function<void(const LogRecord&)> &replay) {
+    close();
+    int file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0) return false;
+    struct stat info;
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+    std::string contents(static_cast<std::size_t>(info.st_size), '\0');
+    std::size_t read = 0;
+    while (read < contents.size()) {
+        ssize_t n = ::pread(file, &contents[read], contents.size() - read, read);
+        if (n <= 0) break;
+        read += static_cast<std::size_t>(n);
+    }
+    contents.resize(read);
+
+    // Replay the valid prefix of the log.
+    std::uint64_t last = afterSequence;
+    std::size_t offset = 0;
+    while (contents.size() - offset >= LOG_FRAME_BYTES) {
+        std::uint32_t length = getValue<std::uint32_t>(&contents[offset]);
+        std::uint32_t checksum = getValue<std::uint32_t>(&contents[offset + 4]);
+        if (length < LOG_FIXED_PAYLOAD || length > contents.size() - offset - LOG_FRAME_BYTES) break;
+        const char *payload = &contents[offset + LOG_FRAME_BYTES];
+        if (crc32(payload, length) != checksum) break;
+
+        std::uint64_t sequence = getValue<std::uint64_t>(payload);
+        LogRecord record;
+        record.op = static_cast<LogOp>(payload[8]);
+        record.id = getValue<std::int32_t>(payload + 9);
+        record.amount = Money::fromMinorUnits(getValue<std::int64_t>(payload + 13));
+        if (record.op == LogOp::Transfer) {
+            if (length != LOG_FIXED_PAYLOAD + sizeof(std::int32_t)) break;
+            record.target = getValue<std::int32_t>(payload + LOG_FIXED_PAYLOAD);
+        } else {
+            record.name = std::string_view(payload + LOG_FIXED_PAYLOAD, length - LOG_FIXED_PAYLOAD);
+        }
+        if (sequence > afterSequence) replay(record);
+        if (sequence > last) last = sequence;
+        offset += LOG_FRAME_BYTES + length;
+    }
+    // Cut off a torn tail so new records are not written after garbage.
+    if (offset != contents.size() && (::ftruncate(file, offset) != 0 || ::fsync(file) != 0)) {
+        ::close(file);
+        return false;
+    }
+    if (::lseek(file, 0, SEEK_END) < 0) {
+        ::close(file);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = file;
+    closing = false;
+    failed = false;
+    pending.clear();
+    nextSequence = last + 1;
+    pendingSequence = durableSequence = last;
+    durableBytes = static_cast<off_t>(offset);
+    flusher = std::thread(&WriteAheadLog::flushLoop, this);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd < 0) return;
+        closing = true;
+    }
+    pendingReady.notify_one();
+    flusher.join();
+    std::vector<std::function<void()>> settled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ::close(fd);
+        fd = -1;
+        settled = takeSettled();
+    }
+    for (auto &ready : settled) ready();
+}
+
+bool WriteAheadLog::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd >= 0 && !closing;
+}
+
+std::uint64_t WriteAheadLog::append(const LogRecord &record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0 || closing || failed) return 0;
+    std::uint64_t sequence = nextSequence++;
+    std::size_t frame = pending.size();
+    bool transfer = record.op == LogOp::Transfer;
+    std::size_t tail = transfer ? sizeof(std::int32_t) : record.name.size();
+    putValue<std::uint32_t>(pending, static_cast<std::uint32_t>(LOG_FIXED_PAYLOAD + tail));
+    putValue<std::uint32_t>(pending, 0); // Checksum, filled in below
+    putValue<std::uint64_t>(pending, sequence);
+    putValue<std::uint8_t>(pending, static_cast<std::uint8_t>(record.op));
+    putValue<std::int32_t>(pending, record.id);
+    putValue<std::int64_t>(pending, record.amount.minorUnits());
+    if (transfer) putValue<std::int32_t>(pending, record.target);
+    else pending.append(record.name);
+    std::uint32_t checksum = crc32(&pending[frame + LOG_FRAME_BYTES], pending.size() - frame - LOG_FRAME_BYTES);
+    std::memcpy(&pending[frame + 4], &checksum, sizeof(checksum));
+    pendingSequence = sequence;
+    pendingReady.notify_one();
+    return sequence;
+}
+
+bool WriteAheadLog::waitDurable(std::uint64_t sequence) {
+    if (sequence == 0) return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    flushed.wait(lock, [&] { return durableSequence >= sequence || failed || fd < 0; });
+    return durableSequence >= sequence;
+}
+
+void WriteAheadLog::whenDurable(std::uint64_t sequence, std::function<void()> ready) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sequence != 0 && durableSequence < sequence && !failed && fd >= 0) {
+            waiters.emplace_back(sequence, std::move(ready));
+            return;
+        }
+    }
+    ready();
+}
+
+std::vector<std::function<void()>> WriteAheadLog::takeSettled() {
+    std::vector<std::function<void()>> settled;
+    bool all = failed || fd < 0;
+    auto kept = waiters.begin();
+    for (auto &waiter : waiters) {
+        if (all || waiter.first <= durableSequence) settled.push_back(std::move(waiter.second));
+        else *kept++ = std::move(waiter);
+    }
+    waiters.erase(kept, waiters.end());
+    return settled;
+}
+
+bool WriteAheadLog::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    flushed.wait(lock, [&] { return (pending.empty() && !flushing) || failed || fd < 0; });
+    return durableSequence == nextSequence - 1;
+}
+
+bool WriteAheadLog::commit(const LogRecord &record) {
+    return waitDurable(append(record));
+}
+
+bool WriteAheadLog::truncate() {
+    std::unique_lock<std::mutex> lock(mutex);
+    // Let the flusher drain; it cannot start another batch while the lock is held.
+    flushed.wait(lock, [&] { return (pending.empty() && !flushing) || failed || fd < 0; });
+    if (fd < 0 || failed) return false;
+    if (::ftruncate(fd, 0) != 0 || ::lseek(fd, 0, SEEK_SET) != 0 || ::fsync(fd) != 0) return false;
+    durableBytes = 0;
+    return true;
+}
+
+std::uint64_t WriteAheadLog::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextSequence - 1;
+}
+
+std::uint64_t WriteAheadLog::lastDurable() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return durableSequence;
+}
+
+std::uint64_t WriteAheadLog::syncCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return syncs;
+}
+
+void WriteAheadLog::flushLoop() {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pendingReady.wait(lock, [&] { return !pending.empty() || closing; });
+        if (pending.empty()) break; // Closing with nothing left to write.
+        batch.swap(pending);
+        std::uint64_t batchSequence = pendingSequence;
+        int file = fd;
+        flushing = true;
+        lock.unlock();
+
+        // Appenders keep filling the other buffer while this batch goes to disk.
+        bool ok = true;
+        for (std::size_t written = 0; ok && written < batch.size(); ) {
+            ssize_t n = ::write(file, batch.data() + written, batch.size() - written);
+            if (n < 0) ok = false;
+            else written += static_cast<std::size_t>(n);
+        }
+        ok = ok && ::fdatasync(file) == 0;
+        // Callers are told these records are lost, so a partly written group must not
+        // survive to be replayed. Cutting it off is best effort: the disk is failing.
+        if (!ok && ::ftruncate(file, durableBytes) == 0) ::fdatasync(file);
+
+        lock.lock();
+        flushing = false;
+        ++syncs;
+        if (ok) {
+            durableSequence = batchSequence;
+            durableBytes += static_cast<off_t>(batch.size());
+        } else {
+            failed = true;
+        }
+        batch.clear();
+        flushed.notify_all();
+        std::vector<std::function<void()>> settled = takeSettled();
+        if (!settled.empty()) {
+            lock.unlock();
+            for (auto &ready : settled) ready();
+            lock.lock();
+        }
+        if (failed) break;
+    }
+    flushed.notify_all();
+}
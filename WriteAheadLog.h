@@ -0,0 +1,145 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include "Money.h"
+
+// The kinds of bank mutations recorded in the write-ahead log.
+enum class LogOp : std::uint8_t { Deposit = 1, Withdraw = 2, Add = 3, Delete = 4, Transfer = 5 };
+
+// One logged mutation.
+struct LogRecord {
+    LogOp op;
+    int id;                 // Account the mutation applies to; the paying account of a transfer
+    Money amount;           // Deposited, withdrawn or transferred amount, or the opening balance of an added account
+    std::string_view name;  // Holder name of an added account; empty for other operations
+    int target = 0;         // Receiving account of a transfer; 0 for other operations
+};
+
+// The WriteAheadLog class makes bank mutations durable. Every record is framed as
+//
+//   length    uint32, size of the payload
+//   checksum  uint32, CRC-32 of the payload
+//   payload   uint64 sequence, uint8 op, int32 id, int64 amount, then the name bytes,
+//             or the int32 target of a transfer
+//
+// so a record torn by a crash, or any later garbage, fails its checksum and ends
+// the log. A transfer is one record, so a crash can never leave it half applied.
+// Appending is thread-safe and only copies the record into a buffer. A single
+// flusher thread writes and fsyncs whatever has piled up since its last sync, so
+// under load one fsync commits a whole group of concurrent operations. If a write
+// or sync fails, the log stops accepting records and cuts the failed group back
+// off the file, so no record reported as lost is replayed later.
+class WriteAheadLog {
+public:
+    WriteAheadLog() = default;
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * Opens a log for appending, creating it if needed. The records already in the
+     * file are replayed first, in order; a torn or corrupt tail is cut off.
+     * @param path The path of the log file.
+     * @param afterSequence Records up to this sequence number are already reflected
+     * elsewhere (in a snapshot) and are not replayed. New records are numbered after
+     * both this and the last record in the file.
+     * @param replay Called with every record to replay.
+     * @return true if the log was opened, false otherwise.
+    */
+    bool open(const std::string &path, std::uint64_t afterSequence,
+              const std::function<void(const LogRecord&)> &replay);
+
+    // Flushes every appended record and closes the log.
+    void close();
+
+    // Tells whether the log is open.
+    bool isOpen() const;
+
+    /**
+     * Queues a record for the next group commit. Does not wait for the disk.
+     * @param record The record to append.
+     * @return The record's sequence number, or 0 if the log is closed or has failed.
+    */
+    std::uint64_t append(const LogRecord &record);
+
+    /**
+     * Blocks until a record and every record before it are on disk.
+     * @param sequence A sequence number returned by append().
+     * @return true once the record is durable, false if it never will be.
+    */
+    bool waitDurable(std::uint64_t sequence);
+
+    /**
+     * Calls a function once a record is on disk or known never to get there, without
+     * blocking the caller; waitDurable() then returns at once.
+     * @param sequence A sequence number returned by append().
+     * @param ready Called once, from the flusher thread, or right away if the outcome
+     * is already known. It must not block or append to the log.
+    */
+    void whenDurable(std::uint64_t sequence, std::function<void()> ready);
+
+    /**
+     * Blocks until every record appended so far is on disk.
+     * @return true once they are durable, false if some never will be.
+    */
+    bool flush();
+
+    /**
+     * Appends a record and waits until it is durable.
+     * @param record The record to commit.
+     * @return true if the record is durable, false otherwise.
+    */
+    bool commit(const LogRecord &record);
+
+    /**
+     * Empties the log once its records are reflected in a snapshot. Records appended
+     * so far are flushed first; numbering continues where it was.
+     * @return true if the log was emptied, false otherwise.
+    */
+    bool truncate();
+
+    // Returns the sequence number of the last appended record.
+    std::uint64_t lastSequence() const;
+
+    // Returns the sequence number of the last record known to be on disk.
+    std::uint64_t lastDurable() const;
+
+    // Returns the number of fsyncs done so far, to tell how well commits are grouped.
+    std::uint64_t syncCount() const;
+
+private:
+    // Body of the flusher thread: writes and syncs pending records until closed.
+    void flushLoop();
+
+    // Helper function to take the whenDurable() callbacks whose records are settled. The caller holds the mutex
+    std::vector<std::function<void()>> takeSettled();
+
+    mutable std::mutex mutex;              // Guards every member below
+    std::condition_variable pendingReady;  // Signalled when records are appended or the log closes
+    std::condition_variable flushed;       // Signalled after every group commit
+    std::thread flusher;                   // Writes and syncs pending records
+    std::string pending;                   // Encoded records not yet written
+    int fd = -1;                           // Log file descriptor
+    bool closing = false;                  // Tells the flusher to drain and exit
+    bool flushing = false;                 // The flusher is writing a batch outside the lock
+    bool failed = false;                   // A write or sync failed; no record is durable any more
+    std::uint64_t nextSequence = 1;        // Sequence number of the next appended record
+    std::uint64_t pendingSequence = 0;     // Last record in pending
+    std::uint64_t durableSequence = 0;     // Last record known to be on disk
+    off_t durableBytes = 0;                // Length of the file up to that record
+    std::uint64_t syncs = 0;               // Number of fsyncs done
+    std::vector<std::pair<std::uint64_t, std::function<void()>>> waiters; // whenDurable() callbacks, by sequence
+};
+
+#endif // WRITE_AHEAD_LOG_H